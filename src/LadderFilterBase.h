@@ -15,6 +15,8 @@ public:
 	virtual void Process(float * samples, uint32_t n) = 0;
 	virtual void SetResonance(float r) = 0;
 	virtual void SetCutoff(float c) = 0;
+	// Only the models with a tanh in them do anything with this
+	virtual void SetFastSaturation(bool fast) {}
 
 	float GetResonance() { return resonance; }
 	float GetCutoff() { return cutoff; }
@@ -9,6 +9,7 @@
 
 #include "LadderFilterBase.h"
 #include "Util.h"
+#include "sharedTables.h"
 
 class VAOnePole
 {
@@ -72,6 +73,7 @@ public:
 
 		saturation = 1.0;
 		Q = 3.0;
+		fastSaturation = false;
 
 		SetCutoff(1000.f);
 		SetResonance(0.1f);
@@ -102,7 +104,7 @@ public:
 			// calculate input to first filter
 			double u = (input - K * sigma) * alpha0;
 
-			u = tanh(saturation * u);
+			u = fastSaturation ? fast_tanh(saturation * u) : tanh(saturation * u);
 
 			double stage1 = LPF1->Tick(u);
 			double stage2 = LPF2->Tick(stage1);
@@ -119,6 +121,10 @@ public:
 		}
 	}
 
+	// Rational tanh approximation instead of std::tanh, cheaper but a little
+	// less smooth when the filter is driven hard
+	virtual void SetFastSaturation(bool fast) override { fastSaturation = fast; }
+
 	virtual void SetResonance(float r) override
         {
              // this maps resonance = 1->10 to K = 0 -> 4
@@ -129,10 +135,9 @@ public:
 	{
 		cutoff = c;
 
-		// prewarp for BZT
-		double wd = 2.0 * MOOG_PI * cutoff;
+		// prewarp for BZT, tan(wd * T / 2.0) with wd = 2 pi cutoff, from the shared table
 		double T = 1.0 / sampleRate;
-		double wa = (2.0 / T) * tan(wd * T / 2.0);
+		double wa = (2.0 / T) * prewarpTan(cutoff * T);
 		double g = wa * T / 2.0;
 
 		// Feedforward coeff
@@ -171,6 +176,7 @@ private:
 	double alpha0;
 	double Q;
 	double saturation;
+	bool fastSaturation;
 
 	double oberheimCoefs[5];
 };
@@ -0,0 +1,79 @@
+#include "audioSink.h"
+#include "rtAudioSink.h"
+#include "wavSink.h"
+#include "options.h"
+#include <chrono>
+
+class NullSink : public ThreadedSink {
+public:
+    explicit NullSink(bool paced) : ThreadedSink(paced), sinkName(paced ? "null" : "null-fast") {}
+    const char* name() const override { return sinkName; }
+
+private:
+    const char* sinkName;
+};
+
+AudioSink* createAudioSink(const std::string& kind, const std::string& path) {
+    if (kind == "rtaudio") return new RtAudioSink();
+    if (kind == "null") return new NullSink(true);
+    if (kind == "null-fast") return new NullSink(false);
+    if (kind == "wav") return new WavSink(path);
+    return nullptr;
+}
+
+ThreadedSink::~ThreadedSink() {
+    stop();
+}
+
+bool ThreadedSink::open(unsigned int& rate, unsigned int& frames, RenderCallback callback, void* userData) {
+    if (rate == 0) rate = DEFAULT_SAMPLE_RATE;
+    if (frames == 0) frames = DEFAULT_BUFFER_FRAMES;
+    sampleRate = rate;
+    bufferFrames = frames;
+    this->callback = callback;
+    this->userData = userData;
+    buffer.assign(bufferFrames * CHANNELS, 0.0f);
+    return true;
+}
+
+bool ThreadedSink::start() {
+    if (!callback || thread.joinable()) return false;
+    stopRequested.store(false);
+    running.store(true);
+    thread = std::thread(&ThreadedSink::loop, this);
+    return true;
+}
+
+void ThreadedSink::stop() {
+    stopRequested.store(true);
+    if (thread.joinable()) thread.join();
+}
+
+// A paced sink sleeps until the next block is due. If rendering a block ran
+// past that point the next callback is told about it, the same way a device
+// reports an underflow, and the schedule starts again from now.
+void ThreadedSink::loop() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(bufferFrames) / sampleRate));
+    Clock::time_point due = Clock::now() + period;
+    bool late = false;
+    while (!stopRequested.load()) {
+        // like RtAudio, the block that asked to stop still gets played
+        bool more = callback(buffer.data(), bufferFrames, late, userData);
+        if (!consume(buffer.data(), bufferFrames) || !more) break;
+        late = false;
+        if (paced) {
+            Clock::time_point now = Clock::now();
+            if (now > due) {
+                late = true;
+                due = now;
+            }
+            else {
+                std::this_thread::sleep_until(due);
+            }
+            due += period;
+        }
+    }
+    running.store(false);
+}
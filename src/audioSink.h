@@ -0,0 +1,75 @@
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Where the rendered audio goes. Every sink pulls blocks of interleaved
+// stereo float from a render callback on a thread of its own, the way
+// RtAudio does, so the engine can't tell a sound card from a file.
+//
+//   rtaudio     the default output device
+//   null        throws the audio away but keeps real-time pacing
+//   null-fast   throws the audio away as fast as it can be rendered
+//   wav         streams 32-bit float WAV to a file, as fast as it can be rendered
+class AudioSink {
+public:
+    static const unsigned int CHANNELS = 2;
+
+    // Fills out with nFrames frames. underflow is set when the previous block
+    // was late. Returning false stops the sink after this block.
+    typedef bool (*RenderCallback)(float* out, unsigned int nFrames, bool underflow, void* userData);
+
+    virtual ~AudioSink() {}
+    virtual const char* name() const = 0;
+
+    // Settles the format. A rate or buffer size of 0 lets the sink choose;
+    // either may come back changed.
+    virtual bool open(unsigned int& sampleRate, unsigned int& bufferFrames, RenderCallback callback, void* userData) = 0;
+    // Frames between a block leaving render and being heard
+    virtual unsigned int latencyFrames() const { return 0; }
+
+    virtual bool start() = 0;
+    // false once the sink has stopped, on request or by itself
+    virtual bool isRunning() const = 0;
+    virtual void stop() = 0;
+};
+
+// kind is one of the names above, path is only used by the wav sink.
+// Returns nullptr for an unknown kind.
+AudioSink* createAudioSink(const std::string& kind, const std::string& path);
+
+// The sinks without a device behind them: a thread calling render in a loop,
+// optionally sleeping until each block is due
+class ThreadedSink : public AudioSink {
+public:
+    explicit ThreadedSink(bool paced) : paced(paced) {}
+    ~ThreadedSink() override;
+
+    bool open(unsigned int& sampleRate, unsigned int& bufferFrames, RenderCallback callback, void* userData) override;
+    bool start() override;
+    bool isRunning() const override { return running.load(); }
+    void stop() override;
+
+protected:
+    // Called with every rendered block, on the sink's thread
+    virtual bool consume(const float* /*samples*/, unsigned int /*nFrames*/) { return true; }
+
+    unsigned int sampleRate = 0;
+    unsigned int bufferFrames = 0;
+
+private:
+    void loop();
+
+    bool paced;
+    RenderCallback callback = nullptr;
+    void* userData = nullptr;
+    std::vector<float> buffer;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> stopRequested{false};
+};
+
+#endif
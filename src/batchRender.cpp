@@ -0,0 +1,230 @@
+#include "batchRender.h"
+#include "midiFile.h"
+#include "midiFilePlayer.h"
+#include "patch.h"
+#include "rtCheck.h"
+#include "synth.h"
+#include "wavFile.h"
+#include "workerPool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+static const unsigned int CHANNELS = 2;
+static const size_t OUTPUT_BUFFER_BYTES = 1 << 16;
+
+// Stk's sample rate is a global the Synth constructor writes, and Stk objects
+// add and remove themselves on a static list when built and destroyed
+static std::mutex constructionMutex;
+static std::mutex printMutex;
+
+static std::string resolve(const std::string& directory, const std::string& path) {
+    if (path.empty() || path[0] == '/' || directory.empty()) return path;
+    return directory + "/" + path;
+}
+
+bool readBatchManifest(const std::string& path, std::vector<BatchJob>& jobs, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash);
+
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+        BatchJob job;
+        if (!(fields >> job.midiPath)) continue;
+        std::string extra;
+        if (!(fields >> job.patchPath >> job.outputPath) || (fields >> extra)) {
+            error = path + ":" + std::to_string(number) + ": expected MIDI PATCH OUTPUT";
+            return false;
+        }
+        if (job.patchPath == "-") job.patchPath.clear();
+        job.midiPath = resolve(directory, job.midiPath);
+        job.patchPath = resolve(directory, job.patchPath);
+        job.outputPath = resolve(directory, job.outputPath);
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+class WavStream {
+public:
+    WavStream(unsigned int sampleRate) : sampleRate(sampleRate) {}
+    ~WavStream() { close(); }
+
+    bool open(const std::string& path) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::setvbuf(file, nullptr, _IOFBF, OUTPUT_BUFFER_BYTES);
+        return writeWavHeader(file, sampleRate, CHANNELS, 32, true, 0);
+    }
+    bool write(const float* samples, unsigned int nFrames) {
+        if (std::fwrite(samples, sizeof(float) * CHANNELS, nFrames, file) != nFrames) return false;
+        frames += nFrames;
+        return true;
+    }
+    bool close() {
+        if (!file) return true;
+        bool ok = writeWavHeader(file, sampleRate, CHANNELS, 32, true, frames * sizeof(float) * CHANNELS);
+        ok = std::fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+    uint64_t getFrames() const { return frames; }
+
+private:
+    unsigned int sampleRate;
+    FILE* file = nullptr;
+    uint64_t frames = 0;
+};
+
+struct LockedSynthDelete {
+    void operator()(Synth* synth) const {
+        std::lock_guard<std::mutex> lock(constructionMutex);
+        delete synth;
+    }
+};
+
+bool renderBatchJob(const BatchJob& job, const BatchSettings& settings, double& audioSeconds, std::string& error) {
+    audioSeconds = 0.0;
+    MidiFile midi;
+    if (!midi.load(job.midiPath, error)) return false;
+    Patch patch;
+    if (!job.patchPath.empty() && !loadPatch(job.patchPath, patch, error)) return false;
+
+    SynthConfig config;
+    config.sampleRate = settings.sampleRate;
+    config.maxFrames = settings.blockFrames;
+    config.voices = settings.voices;
+    std::unique_ptr<Synth, LockedSynthDelete> synth;
+    {
+        std::lock_guard<std::mutex> lock(constructionMutex);
+        synth.reset(new Synth(config));
+    }
+    SynthEngine* engine = synth->getEngine();
+    // offline, a block has no deadline to back off for
+    engine->getGovernor().setEnabled(false);
+    engine->setQualityTier(settings.quality);
+    applyPatch(engine, patch);
+
+    WavStream out(settings.sampleRate);
+    if (!out.open(job.outputPath)) {
+        error = "could not write " + job.outputPath;
+        return false;
+    }
+    std::vector<float> buffer(settings.blockFrames * CHANNELS);
+    uint64_t frame = 0;
+    // events land on their exact frame: render up to it, then queue it for the next block
+    auto renderTo = [&](uint64_t target) {
+        while (frame < target) {
+            unsigned int n = static_cast<unsigned int>(std::min<uint64_t>(target - frame, settings.blockFrames));
+            {
+                RtCheckScope realtime;
+                engine->render(buffer.data(), n, CHANNELS);
+            }
+            if (!out.write(buffer.data(), n)) return false;
+            frame += n;
+        }
+        return true;
+    };
+
+    MidiDispatch dispatch;
+    SynthEvent translated[MidiDispatch::MAX_EVENTS];
+    uint64_t dropped = 0;
+    for (const MidiFileEvent& e : midi.getEvents()) {
+        uint64_t target = static_cast<uint64_t>(std::llround(e.seconds * settings.sampleRate));
+        if (!renderTo(target)) {
+            error = "writing " + job.outputPath + " failed";
+            return false;
+        }
+        int count = translateMidiFileEvent(dispatch, e, translated);
+        for (int i = 0; i < count; ++i) {
+            if (!engine->pushEvent(translated[i])) ++dropped;
+        }
+    }
+    // let the releases ring out
+    uint64_t tailEnd = frame + static_cast<uint64_t>(settings.maxTailSeconds * settings.sampleRate);
+    do {
+        if (!renderTo(std::min<uint64_t>(frame + settings.blockFrames, tailEnd))) {
+            error = "writing " + job.outputPath + " failed";
+            return false;
+        }
+    } while (frame < tailEnd && engine->activeVoiceCount() > 0);
+
+    if (!out.close()) {
+        error = "finishing " + job.outputPath + " failed";
+        return false;
+    }
+    audioSeconds = static_cast<double>(out.getFrames()) / settings.sampleRate;
+    // more events on one frame than the engine queue holds, the render is missing them
+    if (dropped > 0) {
+        error = job.outputPath + ": " + std::to_string(dropped) + " events didn't fit the engine queue";
+        return false;
+    }
+    return true;
+}
+
+int runBatch(const std::string& manifestPath, const BatchSettings& settings) {
+    std::vector<BatchJob> jobs;
+    std::string error;
+    if (!readBatchManifest(manifestPath, jobs, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    WorkerPool pool(settings.workers);
+    std::cout << "Rendering " << jobs.size() << " jobs on " << pool.getThreadCount() << " threads" << std::endl;
+    std::atomic<int> failed(0);
+    std::atomic<int> done(0);
+    std::mutex totalMutex;
+    double totalAudio = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const BatchJob& job : jobs) {
+        pool.submit([&, job] {
+            auto jobStart = std::chrono::steady_clock::now();
+            double audio = 0.0;
+            std::string jobError;
+            bool ok = renderBatchJob(job, settings, audio, jobError);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - jobStart;
+            {
+                std::lock_guard<std::mutex> lock(totalMutex);
+                totalAudio += audio;
+            }
+            if (!ok) ++failed;
+            int finished = ++done;
+            std::lock_guard<std::mutex> lock(printMutex);
+            std::cout << "[" << finished << "/" << jobs.size() << "] ";
+            if (ok) {
+                std::cout << std::fixed << std::setprecision(1) << job.outputPath << ": " << audio << " s in "
+                          << elapsed.count() << " s (" << audio / elapsed.count() << "x)" << std::endl;
+            }
+            else {
+                std::cout << "FAILED " << jobError << std::endl;
+            }
+        });
+    }
+    pool.wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::fixed << std::setprecision(1) << jobs.size() << " jobs, " << failed.load() << " failed: "
+              << totalAudio << " s of audio in " << elapsed.count() << " s, " << totalAudio / elapsed.count()
+              << "x real time (" << totalAudio / elapsed.count() / pool.getThreadCount() << "x per thread)"
+              << std::endl;
+    if (rtCheckViolations() > 0) rtCheckReport();
+    return failed.load();
+}
@@ -0,0 +1,40 @@
+#ifndef BATCHRENDER_H
+#define BATCHRENDER_H
+
+#include "quality.h"
+#include <string>
+#include <vector>
+
+// One line of a batch manifest: render midiPath with patchPath (empty for
+// the default sound) into the WAV file outputPath
+struct BatchJob {
+    std::string midiPath;
+    std::string patchPath;
+    std::string outputPath;
+};
+
+struct BatchSettings {
+    unsigned int sampleRate = 48000;
+    unsigned int blockFrames = 512;
+    int voices = 8;
+    int workers = 0;                    // 0 = one per core
+    QualityTier quality = QUALITY_STANDARD;    // unless the patch says otherwise
+    double maxTailSeconds = 10.0;       // after the last event, stop once everything is silent or after this
+};
+
+// Manifest lines are `MIDI PATCH OUTPUT`, whitespace separated, with `-` for
+// no patch; # starts a comment. Relative paths are taken from the manifest's
+// directory.
+bool readBatchManifest(const std::string& path, std::vector<BatchJob>& jobs, std::string& error);
+
+// Renders one job with its own engine, streaming float WAV to the output as
+// it goes. audioSeconds is how much got written. Events that don't fit the
+// engine queue fail the job, its output is still written.
+bool renderBatchJob(const BatchJob& job, const BatchSettings& settings, double& audioSeconds, std::string& error);
+
+// Runs every job of the manifest on a WorkerPool, at most one engine per
+// thread alive at a time, and prints each job and the aggregate real-time
+// factor. Returns the number of jobs that failed.
+int runBatch(const std::string& manifestPath, const BatchSettings& settings);
+
+#endif
@@ -0,0 +1,186 @@
+#include "benchmark.h"
+#include "synthFarm.h"
+#include "sharedTables.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+static const int CAPACITY_STEP_VOICES = 4;
+static const double CAPACITY_WARMUP_SECONDS = 0.5;
+static const double CAPACITY_MAX_XRUN_FRACTION = 0.01;
+static const double CAPACITY_MAX_TAIL_SECONDS = 5.0;
+
+static void playChord(SynthEngine* engine, SynthEventType type, int transpose = 0) {
+    for (int i = 0; i < engine->getVoiceCount(); ++i) {
+        SynthEvent event = {};
+        event.type = type;
+        event.note = static_cast<uint8_t>(36 + (i * 7 + transpose) % 48);
+        event.velocity = 100;
+        event.receivedNs = 0;
+        engine->pushEvent(event);
+    }
+}
+
+static void benchmarkTier(SynthEngine* engine, QualityTier tier, double seconds, unsigned int blockFrames) {
+    engine->setQualityTier(tier);
+    std::vector<float> buffer(blockFrames * 2);
+    // retrigger so every tier renders the same notes from the start, and
+    // let the switch and its crossfade happen before the clock starts
+    playChord(engine, EVENT_NOTE_OFF);
+    playChord(engine, EVENT_NOTE_ON);
+    engine->render(buffer.data(), blockFrames, 2);
+    engine->getStats().reset();
+    engine->getCycleStats().reset();
+
+    uint64_t blocks = static_cast<uint64_t>(seconds * engine->getSampleRate() / blockFrames);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t b = 0; b < blocks; ++b) {
+        engine->render(buffer.data(), blockFrames, 2);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double rendered = static_cast<double>(blocks) * blockFrames / engine->getSampleRate();
+    std::cout << std::fixed << std::setprecision(2)
+              << qualityTierName(tier) << ": rendered " << rendered << " s of audio ("
+              << engine->getVoiceCount() << " voices, " << blockFrames << " frame blocks) in " << elapsed.count() << " s: "
+              << rendered / elapsed.count() << "x real time" << std::endl;
+    std::cout << EngineStats::toText(engine->getStats().snapshot()) << std::endl;
+    std::cout << CycleStats::toText(engine->getCycleStats().snapshot());
+}
+
+void runBenchmark(SynthEngine* engine, double seconds, unsigned int blockFrames) {
+    QualityTier original = engine->getQualityTier();
+    for (int t = 0; t < QUALITY_TIER_COUNT; ++t) {
+        benchmarkTier(engine, static_cast<QualityTier>(t), seconds, blockFrames);
+    }
+    engine->setQualityTier(original);
+}
+
+void runFarmBenchmark(const SynthConfig& config, QualityTier tier, int instances, int workers, double seconds) {
+    SynthFarm farm(config, instances, workers);
+    size_t minBytes = SIZE_MAX, maxBytes = 0, totalBytes = 0;
+    for (int i = 0; i < instances; ++i) {
+        // a different chord on every instance, so they aren't all doing the same thing
+        farm.getInstance(i).getEngine()->setQualityTier(tier);
+        playChord(farm.getInstance(i).getEngine(), EVENT_NOTE_ON, i);
+        size_t bytes = farm.getInstance(i).getMemoryBytes();
+        minBytes = std::min(minBytes, bytes);
+        maxBytes = std::max(maxBytes, bytes);
+        totalBytes += bytes;
+    }
+    std::cout << std::fixed << std::setprecision(1)
+              << instances << " instances of " << config.voices << " voices at " << qualityTierName(tier) << " quality, " << farm.getPool().getThreadCount()
+              << " worker threads" << std::endl;
+    std::cout << "memory per instance " << minBytes / 1024.0 << " KiB min, " << totalBytes / 1024.0 / instances
+              << " avg, " << maxBytes / 1024.0 << " max; shared tables " << sharedTablesBytes() / 1024.0 << " KiB"
+              << std::endl;
+
+    uint64_t blocks = static_cast<uint64_t>(seconds * config.sampleRate / config.maxFrames);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t b = 0; b < blocks; ++b) farm.render(config.maxFrames, 2);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double rendered = static_cast<double>(blocks) * config.maxFrames / config.sampleRate;
+    uint64_t xruns = 0;
+    for (int i = 0; i < instances; ++i) xruns += farm.getInstance(i).getEngine()->getStats().snapshot().xruns;
+    std::cout << std::setprecision(2) << "rendered " << rendered << " s of audio per instance in " << elapsed.count()
+              << " s: " << rendered / elapsed.count() << "x real time per instance, "
+              << instances * rendered / elapsed.count() << "x in total" << std::endl;
+    std::cout << "blocks over their own budget " << xruns << ", tasks stolen " << farm.getPool().getSteals() << std::endl;
+}
+
+struct CapacityStep {
+    double polyphony;       // average over the step
+    double p99Load;
+    double xrunFraction;
+};
+
+static CapacityStep capacityStep(SynthEngine* engine, const LoadSettings& load, double seconds, unsigned int blockFrames,
+                                 std::vector<float>& buffer) {
+    LoadGenerator generator(engine, load);
+    double rate = engine->getSampleRate();
+    uint64_t frame = 0;
+    auto renderFor = [&](double duration, double* activeSum) {
+        uint64_t end = frame + static_cast<uint64_t>(duration * rate);
+        uint64_t blocks = 0;
+        while (frame < end) {
+            generator.advanceTo(frame / rate);
+            engine->render(buffer.data(), blockFrames, 2);
+            frame += blockFrames;
+            if (activeSum) *activeSum += engine->activeVoiceCount();
+            ++blocks;
+        }
+        return blocks;
+    };
+
+    // let the polyphony build up before measuring
+    renderFor(CAPACITY_WARMUP_SECONDS, nullptr);
+    engine->getStats().reset();
+    double activeSum = 0.0;
+    uint64_t blocks = renderFor(seconds, &activeSum);
+    EngineStats::Snapshot stats = engine->getStats().snapshot();
+
+    generator.releaseAll();
+    uint64_t tailEnd = frame + static_cast<uint64_t>(CAPACITY_MAX_TAIL_SECONDS * rate);
+    while (engine->activeVoiceCount() > 0 && frame < tailEnd) {
+        engine->render(buffer.data(), blockFrames, 2);
+        frame += blockFrames;
+    }
+
+    CapacityStep step;
+    step.polyphony = blocks > 0 ? activeSum / blocks : 0.0;
+    step.p99Load = stats.p99Load;
+    step.xrunFraction = stats.blocks > 0 ? static_cast<double>(stats.xruns) / stats.blocks : 0.0;
+    return step;
+}
+
+void runCapacityTest(const SynthConfig& config, const LoadSettings& load, double stepSeconds) {
+    std::cout << "Capacity: up to " << config.voices << " voices, " << config.maxFrames << " frame blocks, "
+              << stepSeconds << " s per step, chords of " << load.chordSize << " held " << load.sustainSeconds
+              << " s, " << load.knobChangesPerSecond << " knob moves/s" << std::endl;
+    std::vector<float> buffer(config.maxFrames * 2);
+    for (int t = 0; t < QUALITY_TIER_COUNT; ++t) {
+        QualityTier tier = static_cast<QualityTier>(t);
+        for (int m = 0; m < FILTER_MODEL_COUNT; ++m) {
+            FilterModel model = static_cast<FilterModel>(m);
+            Synth synth(config);
+            SynthEngine* engine = synth.getEngine();
+            // the point is to find where it breaks, not to have the governor hide it
+            engine->getGovernor().setEnabled(false);
+            engine->setQualityTier(tier);
+            engine->render(buffer.data(), config.maxFrames, 2);
+            // the engine only knows tiers, swap the filter model on the voices behind its back
+            QualitySettings settings = qualitySettings(tier);
+            settings.filter = model;
+            for (int i = 0; i < synth.getVoiceCount(); ++i) synth.getVoices()[i]->setQuality(settings);
+
+            CapacityStep best = {0.0, 0.0, 0.0};
+            double failedAt = 0.0;
+            for (int target = CAPACITY_STEP_VOICES;; target += CAPACITY_STEP_VOICES) {
+                target = std::min(target, synth.getVoiceCount());
+                // Little's law: notes sounding = note rate * time held
+                LoadSettings stepLoad = load;
+                stepLoad.chordsPerSecond = target / (std::max(1, load.chordSize) * load.sustainSeconds);
+                // a pitch is only held once, so there have to be enough of them
+                stepLoad.pitchSpread = std::max(load.pitchSpread, target + load.chordSize);
+                CapacityStep step = capacityStep(engine, stepLoad, stepSeconds, config.maxFrames, buffer);
+                if (step.xrunFraction > CAPACITY_MAX_XRUN_FRACTION) {
+                    failedAt = step.polyphony;
+                    break;
+                }
+                best = step;
+                if (target == synth.getVoiceCount()) break;
+            }
+
+            std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(9) << qualityTierName(tier)
+                      << std::setw(13) << filterModelName(model) << std::right << best.polyphony
+                      << " voices sustained, p99 load " << std::setprecision(0) << best.p99Load << "%";
+            if (failedAt > 0) std::cout << std::setprecision(1) << ", xruns at " << failedAt;
+            else std::cout << ", no xruns at the voice limit";
+            std::cout << std::endl;
+        }
+    }
+}
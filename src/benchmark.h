@@ -0,0 +1,26 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "synthEngine.h"
+#include "synth.h"
+#include "loadGenerator.h"
+
+// Holds a chord on every voice and renders `seconds` of it as fast as
+// possible at every quality tier, no audio device involved. For each tier
+// prints the real-time factor, the block statistics and the per-stage
+// voice costs.
+void runBenchmark(SynthEngine* engine, double seconds, unsigned int blockFrames);
+
+// `instances` independent synths, each holding a different chord, rendered
+// together on `workers` threads (0 = one per core). Prints the memory each
+// instance takes, the shared tables and the total throughput.
+void runFarmBenchmark(const SynthConfig& config, QualityTier tier, int instances, int workers, double seconds);
+
+// For every quality tier with each filter model: plays the load at rising
+// polyphony, stepSeconds per step rendered flat out, until more than 1% of
+// the blocks go over their real-time budget or the voices run out. Prints
+// the highest polyphony that held. The load's chord rate is scaled to aim
+// at each step; its other settings are used as given.
+void runCapacityTest(const SynthConfig& config, const LoadSettings& load, double stepSeconds);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef CYCLECOUNTER_H
+#define CYCLECOUNTER_H
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_COUNTER_UNIT "cycles"
+inline uint64_t readCycleCounter() {
+    return __rdtsc();
+}
+#else
+#include <chrono>
+#define CYCLE_COUNTER_UNIT "ns"
+inline uint64_t readCycleCounter() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+enum ProfileStage {
+    STAGE_OSCILLATOR,
+    STAGE_ENVELOPE,
+    STAGE_FILTER_COEFFICIENTS,
+    STAGE_FILTER_PROCESS,
+    STAGE_COUNT
+};
+
+// Filled in by Voice::render() on the blocks the engine chose to profile
+struct VoiceProfile {
+    uint64_t ticks[STAGE_COUNT] = {0, 0, 0, 0};
+    uint64_t samples = 0;
+};
+
+#endif
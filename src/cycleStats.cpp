@@ -0,0 +1,71 @@
+#include "cycleStats.h"
+#include <iomanip>
+#include <sstream>
+
+CycleStats::CycleStats() {
+    reset();
+}
+
+void CycleStats::reset() {
+    for (int f = 0; f < FILTER_MODEL_COUNT; ++f) {
+        for (int o = 0; o < OSCILLATOR_TYPE_COUNT; ++o) {
+            for (int s = 0; s < STAGE_COUNT; ++s) slots[f][o].ticks[s].store(0);
+            slots[f][o].samples.store(0);
+        }
+    }
+}
+
+void CycleStats::add(int filterModel, int oscillatorType, const VoiceProfile& profile) {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    Slot& slot = slots[filterModel][oscillatorType];
+    for (int s = 0; s < STAGE_COUNT; ++s) slot.ticks[s].store(slot.ticks[s].load(relaxed) + profile.ticks[s], relaxed);
+    slot.samples.store(slot.samples.load(relaxed) + profile.samples, relaxed);
+}
+
+std::vector<CycleStats::Row> CycleStats::snapshot() const {
+    std::vector<Row> rows;
+    for (int f = 0; f < FILTER_MODEL_COUNT; ++f) {
+        for (int o = 0; o < OSCILLATOR_TYPE_COUNT; ++o) {
+            uint64_t samples = slots[f][o].samples.load(std::memory_order_relaxed);
+            if (samples == 0) continue;
+            Row row;
+            row.filterModel = f;
+            row.oscillatorType = o;
+            row.samples = samples;
+            for (int s = 0; s < STAGE_COUNT; ++s) {
+                row.perSample[s] = static_cast<double>(slots[f][o].ticks[s].load(std::memory_order_relaxed)) / samples;
+            }
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+
+const char* CycleStats::stageName(int stage) {
+    switch (stage) {
+        case STAGE_OSCILLATOR: return "oscillators";
+        case STAGE_ENVELOPE: return "envelopes";
+        case STAGE_FILTER_COEFFICIENTS: return "filter coefs";
+        case STAGE_FILTER_PROCESS: return "filter";
+    }
+    return "?";
+}
+
+std::string CycleStats::toText(const std::vector<Row>& rows) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "voice cost in " << CYCLE_COUNTER_UNIT << " per sample:\n";
+    for (const Row& row : rows) {
+        double total = 0.0;
+        for (int s = 0; s < STAGE_COUNT; ++s) total += row.perSample[s];
+        out << "  " << filterModelName(static_cast<FilterModel>(row.filterModel))
+            << " / " << oscillatorTypeName(row.oscillatorType) << ":";
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            out << " " << stageName(s) << " " << row.perSample[s]
+                << " (" << std::setprecision(0) << (total > 0 ? 100.0 * row.perSample[s] / total : 0.0)
+                << "%)" << std::setprecision(1);
+        }
+        out << " | total " << total << " over " << row.samples << " samples\n";
+    }
+    return out.str();
+}
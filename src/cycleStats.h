@@ -0,0 +1,39 @@
+#ifndef CYCLESTATS_H
+#define CYCLESTATS_H
+
+#include "cycleCounter.h"
+#include "voice.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Per voice stage costs, summed per filter model and oscillator type.
+// The audio thread is the only writer.
+class CycleStats {
+public:
+    struct Row {
+        int filterModel;
+        int oscillatorType;
+        uint64_t samples;
+        double perSample[STAGE_COUNT];   // CYCLE_COUNTER_UNIT per sample
+    };
+
+    CycleStats();
+
+    // audio thread
+    void add(int filterModel, int oscillatorType, const VoiceProfile& profile);
+
+    std::vector<Row> snapshot() const;
+    void reset();
+    static const char* stageName(int stage);
+    static std::string toText(const std::vector<Row>& rows);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> ticks[STAGE_COUNT];
+        std::atomic<uint64_t> samples;
+    };
+    Slot slots[FILTER_MODEL_COUNT][OSCILLATOR_TYPE_COUNT];
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "engineStats.h"
+#include <sstream>
+#include <iomanip>
+
+EngineStats::EngineStats() {
+    reset();
+}
+
+void EngineStats::reset() {
+    blocks.store(0);
+    xruns.store(0);
+    underflows.store(0);
+    lastRenderNs.store(0);
+    budgetNs.store(0);
+    totalRenderNs.store(0);
+    totalBudgetNs.store(0);
+    lastLoadPermille.store(0);
+    maxLoadPermille.store(0);
+    activeVoices.store(0);
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) histogram[i].store(0);
+}
+
+void EngineStats::recordBlock(uint64_t renderNs, uint64_t blockBudgetNs, int voices) {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    uint32_t permille = blockBudgetNs > 0 ? static_cast<uint32_t>(renderNs * 1000 / blockBudgetNs) : 0;
+
+    int bin = permille / (HISTOGRAM_BIN_PERCENT * 10);
+    if (bin >= HISTOGRAM_BINS) bin = HISTOGRAM_BINS - 1;
+
+    // single writer, so plain load + store is enough for the read-modify-writes
+    histogram[bin].store(histogram[bin].load(relaxed) + 1, relaxed);
+    if (renderNs > blockBudgetNs) xruns.store(xruns.load(relaxed) + 1, relaxed);
+    if (permille > maxLoadPermille.load(relaxed)) maxLoadPermille.store(permille, relaxed);
+    totalRenderNs.store(totalRenderNs.load(relaxed) + renderNs, relaxed);
+    totalBudgetNs.store(totalBudgetNs.load(relaxed) + blockBudgetNs, relaxed);
+    lastRenderNs.store(renderNs, relaxed);
+    budgetNs.store(blockBudgetNs, relaxed);
+    lastLoadPermille.store(permille, relaxed);
+    activeVoices.store(voices, relaxed);
+    blocks.store(blocks.load(relaxed) + 1, std::memory_order_release);
+}
+
+void EngineStats::recordUnderflow() {
+    underflows.fetch_add(1, std::memory_order_relaxed);
+}
+
+EngineStats::Snapshot EngineStats::snapshot() const {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    Snapshot s;
+    s.blocks = blocks.load(std::memory_order_acquire);
+    s.xruns = xruns.load(relaxed);
+    s.underflows = underflows.load(relaxed);
+    s.lastLoad = lastLoadPermille.load(relaxed) / 10.0;
+    s.maxLoad = maxLoadPermille.load(relaxed) / 10.0;
+    s.lastRenderMs = lastRenderNs.load(relaxed) / 1.0e6;
+    s.budgetMs = budgetNs.load(relaxed) / 1.0e6;
+    s.activeVoices = activeVoices.load(relaxed);
+
+    uint64_t totalBudget = totalBudgetNs.load(relaxed);
+    s.averageLoad = totalBudget > 0 ? 100.0 * totalRenderNs.load(relaxed) / totalBudget : 0.0;
+
+    uint64_t counted = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        s.histogram[i] = histogram[i].load(relaxed);
+        counted += s.histogram[i];
+    }
+
+    // p99 is the upper edge of the bin holding the 99th percentile block,
+    // so it is only as precise as the bin width
+    s.p99Load = 0.0;
+    uint64_t threshold = counted - counted / 100;
+    uint64_t running = 0;
+    for (int i = 0; i < HISTOGRAM_BINS && counted > 0; ++i) {
+        running += s.histogram[i];
+        if (running >= threshold) {
+            s.p99Load = (i + 1) * HISTOGRAM_BIN_PERCENT;
+            break;
+        }
+    }
+    if (s.p99Load > s.maxLoad) s.p99Load = s.maxLoad;
+
+    return s;
+}
+
+std::string EngineStats::toText(const Snapshot& s) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "blocks " << s.blocks
+        << " | load " << s.lastLoad << "% avg " << s.averageLoad << "% p99 " << s.p99Load
+        << "% max " << s.maxLoad << "%"
+        << " | render " << std::setprecision(3) << s.lastRenderMs << "/" << s.budgetMs << " ms"
+        << " | xruns " << s.xruns << " underflows " << s.underflows
+        << " | voices " << s.activeVoices;
+    return out.str();
+}
+
+std::string EngineStats::toJson(const Snapshot& s) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3)
+        << "{\"blocks\":" << s.blocks
+        << ",\"xruns\":" << s.xruns
+        << ",\"underflows\":" << s.underflows
+        << ",\"load\":" << s.lastLoad
+        << ",\"avg_load\":" << s.averageLoad
+        << ",\"p99_load\":" << s.p99Load
+        << ",\"max_load\":" << s.maxLoad
+        << ",\"render_ms\":" << s.lastRenderMs
+        << ",\"budget_ms\":" << s.budgetMs
+        << ",\"active_voices\":" << s.activeVoices
+        << ",\"histogram_bin_percent\":" << HISTOGRAM_BIN_PERCENT
+        << ",\"histogram\":[";
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        if (i > 0) out << ",";
+        out << s.histogram[i];
+    }
+    out << "]}";
+    return out.str();
+}
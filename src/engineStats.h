@@ -0,0 +1,59 @@
+#ifndef ENGINESTATS_H
+#define ENGINESTATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Per-block timing gathered by the audio thread. The audio thread is the only
+// writer; the GUI and the stats dumper read with relaxed loads, so a snapshot
+// may mix values from neighbouring blocks but never blocks the writer.
+class EngineStats {
+public:
+    static const int HISTOGRAM_BINS = 40;       // 5% wide, last bin collects >= 195%
+    static const int HISTOGRAM_BIN_PERCENT = 5;
+
+    struct Snapshot {
+        uint64_t blocks;
+        uint64_t xruns;          // blocks that took longer than their budget
+        uint64_t underflows;     // underflows reported by the audio device
+        double lastLoad;         // percent of the block budget
+        double averageLoad;
+        double maxLoad;
+        double p99Load;
+        double lastRenderMs;
+        double budgetMs;
+        int activeVoices;
+        uint64_t histogram[HISTOGRAM_BINS];
+    };
+
+    EngineStats();
+
+    // audio thread
+    void recordBlock(uint64_t renderNs, uint64_t budgetNs, int activeVoices);
+    void recordUnderflow();
+    // Audio thread too, or any thread while nothing renders: the updates are
+    // load-then-store, a reset from elsewhere could be half undone
+    void reset();
+
+    // any thread
+    Snapshot snapshot() const;
+
+    static std::string toText(const Snapshot& s);
+    static std::string toJson(const Snapshot& s);
+
+private:
+    std::atomic<uint64_t> blocks;
+    std::atomic<uint64_t> xruns;
+    std::atomic<uint64_t> underflows;
+    std::atomic<uint64_t> lastRenderNs;
+    std::atomic<uint64_t> budgetNs;
+    std::atomic<uint64_t> totalRenderNs;
+    std::atomic<uint64_t> totalBudgetNs;
+    std::atomic<uint32_t> lastLoadPermille;
+    std::atomic<uint32_t> maxLoadPermille;
+    std::atomic<int> activeVoices;
+    std::atomic<uint64_t> histogram[HISTOGRAM_BINS];
+};
+
+#endif
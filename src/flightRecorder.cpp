@@ -0,0 +1,85 @@
+#include "flightRecorder.h"
+#include "voice.h"
+#include "governor.h"
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+FlightRecorder::FlightRecorder() : blocks(BLOCKS), frozen(false) {}
+
+FlightRecorder::BlockRecord* FlightRecorder::begin() {
+    if (frozen.load(std::memory_order_relaxed)) return nullptr;
+    return &blocks[written % BLOCKS];
+}
+
+void FlightRecorder::commit() {
+    if (frozen.load(std::memory_order_relaxed)) return;
+    ++written;
+}
+
+void FlightRecorder::freeze(const char* reason) {
+    if (frozen.load(std::memory_order_relaxed)) return;
+    freezeReason = reason;
+    frozen.store(true, std::memory_order_release);
+}
+
+void FlightRecorder::unfreeze() {
+    frozen.store(false, std::memory_order_release);
+}
+
+bool FlightRecorder::dump(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    uint64_t first = written > BLOCKS ? written - BLOCKS : 0;
+    out << "{\"reason\":\"" << freezeReason << "\",\"blocks\":[";
+    for (uint64_t i = first; i < written; ++i) {
+        const BlockRecord& b = blocks[i % BLOCKS];
+        out << (i == first ? "\n" : ",\n")
+            << "{\"block\":" << b.block
+            << ",\"start_ns\":" << b.startNs
+            << ",\"render_ns\":" << b.renderNs
+            << ",\"budget_ns\":" << b.budgetNs
+            << ",\"load\":" << (b.budgetNs > 0 ? 100.0 * b.renderNs / b.budgetNs : 0.0)
+            << ",\"frames\":" << b.frames
+            << ",\"events\":" << b.events
+            << ",\"active_voices\":" << b.activeVoices
+            << ",\"governor\":\"" << PolyphonyGovernor::stageName(static_cast<PolyphonyGovernor::Stage>(b.governorStage)) << "\""
+            << ",\"voices\":[";
+        int nVoices = b.nVoices < MAX_VOICES ? b.nVoices : MAX_VOICES;
+        for (int v = 0; v < nVoices; ++v) {
+            const VoiceRecord& voice = b.voices[v];
+            out << (v == 0 ? "" : ",")
+                << "{\"active\":" << static_cast<int>(voice.active)
+                << ",\"filter\":\"" << filterModelName(static_cast<FilterModel>(voice.filterModel)) << "\""
+                << ",\"oversampling\":" << static_cast<int>(voice.oversampling) << "}";
+        }
+        out << "]}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+void flightRecorderDumpLoop(FlightRecorder* recorder, const std::string& directory, int maxDumps,
+                            const std::atomic<bool>& running) {
+    int dumps = 0;
+    long long started = static_cast<long long>(std::time(nullptr));
+    while (running.load()) {
+        if (!recorder->isFrozen()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            continue;
+        }
+        if (dumps >= maxDumps) {
+            // leave it frozen, we already have plenty of post-mortems
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            continue;
+        }
+        std::string path = directory + "/flight-" + std::to_string(started) + "-" + std::to_string(dumps) + ".json";
+        if (recorder->dump(path)) std::cout << "Deadline missed, flight recorder written to " << path << std::endl;
+        else std::cerr << "Could not write flight recorder to " << path << std::endl;
+        ++dumps;
+        recorder->unfreeze();
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Keeps the last BLOCKS blocks of per-block context in memory. When a block
+// misses its deadline the audio thread freezes the recorder, a background
+// thread dumps it to disk and unfreezes it again. While frozen nothing is
+// recorded, so the dump shows the blocks leading up to the miss.
+class FlightRecorder {
+public:
+    static const int BLOCKS = 512;
+    static const int MAX_VOICES = 64;
+
+    struct VoiceRecord {
+        uint8_t active;
+        uint8_t filterModel;
+        uint8_t oversampling;
+    };
+
+    struct BlockRecord {
+        uint64_t block;
+        uint64_t startNs;
+        uint32_t renderNs;
+        uint32_t budgetNs;
+        uint16_t frames;
+        uint16_t events;
+        uint16_t activeVoices;
+        uint16_t nVoices;
+        uint8_t governorStage;
+        VoiceRecord voices[MAX_VOICES];
+    };
+
+    FlightRecorder();
+
+    // audio thread. begin() hands out the slot to fill, commit() publishes it.
+    // Both are no-ops (begin returns nullptr) while the recorder is frozen.
+    BlockRecord* begin();
+    void commit();
+    void freeze(const char* reason);
+
+    // dump thread
+    bool isFrozen() const { return frozen.load(std::memory_order_acquire); }
+    bool dump(const std::string& path) const;
+    void unfreeze();
+
+private:
+    std::vector<BlockRecord> blocks;
+    uint64_t written = 0;
+    std::atomic<bool> frozen;
+    const char* freezeReason = "";
+};
+
+// Background thread body: waits for the recorder to freeze, writes
+// flight-N.json into directory and unfreezes it, at most maxDumps times.
+void flightRecorderDumpLoop(FlightRecorder* recorder, const std::string& directory, int maxDumps,
+                            const std::atomic<bool>& running);
+
+#endif
@@ -0,0 +1,31 @@
+// Headless golden check, `make golden`: links only the engine, so it builds
+// and runs without SDL, a display, an audio device or MIDI.
+//
+//   golden_check [--update] [--only TEXT] [DIR]
+//
+// DIR defaults to the golden/ references next to this file.
+
+#include "goldenRender.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    GoldenSettings settings;
+    settings.directory = "golden";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--update") == 0) {
+            settings.update = true;
+        }
+        else if (std::strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            settings.only = argv[++i];
+        }
+        else if (argv[i][0] != '-') {
+            settings.directory = argv[i];
+        }
+        else {
+            std::cerr << "usage: " << argv[0] << " [--update] [--only TEXT] [DIR]" << std::endl;
+            return 2;
+        }
+    }
+    return runGolden(settings) == 0 ? 0 : 1;
+}
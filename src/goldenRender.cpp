@@ -0,0 +1,336 @@
+#include "goldenRender.h"
+#include "synth.h"
+#include "wavFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+static const unsigned int SAMPLE_RATE = 48000;
+// not a power of two on purpose, events and the voices' chunks land mid-block
+static const unsigned int BLOCK_FRAMES = 200;
+static const int VOICES = 8;
+static const size_t FFT_SIZE = 1024;
+// frames quieter than this (FFT magnitude) are silence and not compared spectrally
+static const double SILENT_MAGNITUDE = 1.0e-3;
+
+struct GoldenNote {
+    double on;
+    double off;
+    uint8_t note;
+    uint8_t velocity;
+};
+
+struct GoldenScenario {
+    std::string name;
+    QualityTier tier;
+    int oscillatorType;     // osc1 * 2 + osc2, as Voice::getOscillatorType()
+    double seconds;
+    std::vector<GoldenNote> notes;
+    std::vector<std::pair<SynthParam, float>> parameters;    // set before the first block
+    SynthParam sweep;       // PARAM_COUNT for none, otherwise moved linearly over the whole render
+    float sweepFrom;
+    float sweepTo;
+};
+
+// A staggered chord, a staccato note over it, and a retrigger during the releases
+static std::vector<GoldenNote> notePattern() {
+    return {
+        {0.00, 0.60, 48, 100}, {0.05, 0.60, 52, 90}, {0.10, 0.60, 55, 80},
+        {0.30, 0.40, 79, 127}, {0.70, 0.90, 48, 64},
+    };
+}
+
+static std::vector<GoldenScenario> buildScenarios() {
+    static const char* waveformNames[OSCILLATOR_TYPE_COUNT] = {"saw-saw", "saw-square", "square-saw", "square-square"};
+    std::vector<GoldenScenario> scenarios;
+    for (int t = 0; t < QUALITY_TIER_COUNT; ++t) {
+        QualityTier tier = static_cast<QualityTier>(t);
+        for (int type = 0; type < OSCILLATOR_TYPE_COUNT; ++type) {
+            GoldenScenario s = {};
+            s.name = std::string("notes-") + qualityTierName(tier) + "-" + waveformNames[type];
+            s.tier = tier;
+            s.oscillatorType = type;
+            s.seconds = 1.2;
+            s.notes = notePattern();
+            s.parameters = {{PARAM_AEG_SUSTAIN, 0.6f}, {PARAM_CUTOFF, 400.0f}, {PARAM_FEG_AMOUNT, 300.0f}};
+            s.sweep = PARAM_COUNT;
+            scenarios.push_back(s);
+        }
+    }
+
+    // knob sweeps on one held note: the filter ones on every tier, the rest where the sound is the original
+    struct Sweep {
+        const char* name;
+        SynthParam param;
+        float from;
+        float to;
+        bool everyTier;
+    };
+    static const Sweep sweeps[] = {
+        {"cutoff", PARAM_CUTOFF, 20.0f, 1000.0f, true},
+        {"resonance", PARAM_RESONANCE, 0.1f, 10.0f, true},
+        {"feg-amount", PARAM_FEG_AMOUNT, 0.0f, 1000.0f, true},
+        {"xmod", PARAM_XMOD, 0.0f, 1.0f, false},
+        {"osc2-tune", PARAM_OSC2_TUNE, 1.0f / 1.05946f, 1.05946f, false},
+        {"osc2-volume", PARAM_OSC2_VOLUME, 0.0f, 1.0f, false},
+    };
+    for (const Sweep& sweep : sweeps) {
+        for (int t = 0; t < QUALITY_TIER_COUNT; ++t) {
+            QualityTier tier = static_cast<QualityTier>(t);
+            if (!sweep.everyTier && tier != QUALITY_STANDARD) continue;
+            GoldenScenario s = {};
+            s.name = std::string("sweep-") + sweep.name + "-" + qualityTierName(tier);
+            s.tier = tier;
+            s.oscillatorType = 1;
+            s.seconds = 1.0;
+            s.notes = {{0.0, 0.9, 45, 100}};
+            s.parameters = {{PARAM_AEG_SUSTAIN, 1.0f}};
+            // resonance only shows with the cutoff down
+            if (sweep.param != PARAM_CUTOFF) s.parameters.push_back({PARAM_CUTOFF, 300.0f});
+            s.sweep = sweep.param;
+            s.sweepFrom = sweep.from;
+            s.sweepTo = sweep.to;
+            scenarios.push_back(s);
+        }
+    }
+    return scenarios;
+}
+
+static void pushNote(SynthEngine* engine, SynthEventType type, const GoldenNote& note) {
+    SynthEvent event = {};
+    event.type = type;
+    event.note = note.note;
+    event.velocity = note.velocity;
+    engine->pushEvent(event);
+}
+
+// Mono, from a fresh engine every time so nothing carries over between scenarios
+static std::vector<float> renderScenario(const GoldenScenario& s) {
+    SynthConfig config;
+    config.sampleRate = SAMPLE_RATE;
+    config.maxFrames = BLOCK_FRAMES;
+    config.voices = VOICES;
+    Synth synth(config);
+    SynthEngine* engine = synth.getEngine();
+    engine->getGovernor().setEnabled(false);
+    engine->setQualityTier(s.tier);
+    engine->setParameter(PARAM_OSC1_WAVEFORM, static_cast<float>(s.oscillatorType / 2));
+    engine->setParameter(PARAM_OSC2_WAVEFORM, static_cast<float>(s.oscillatorType % 2));
+    for (const auto& p : s.parameters) engine->setParameter(p.first, p.second);
+
+    struct Change {
+        uint64_t frame;
+        bool on;
+        const GoldenNote* note;
+    };
+    std::vector<Change> changes;
+    for (const GoldenNote& note : s.notes) {
+        changes.push_back({static_cast<uint64_t>(std::llround(note.on * SAMPLE_RATE)), true, &note});
+        changes.push_back({static_cast<uint64_t>(std::llround(note.off * SAMPLE_RATE)), false, &note});
+    }
+    std::stable_sort(changes.begin(), changes.end(), [](const Change& a, const Change& b) { return a.frame < b.frame; });
+
+    uint64_t total = static_cast<uint64_t>(std::llround(s.seconds * SAMPLE_RATE));
+    std::vector<float> out(total);
+    uint64_t frame = 0;
+    size_t next = 0;
+    while (frame < total) {
+        // events land on their exact frame, they are applied at the start of the next render()
+        while (next < changes.size() && changes[next].frame <= frame) {
+            pushNote(engine, changes[next].on ? EVENT_NOTE_ON : EVENT_NOTE_OFF, *changes[next].note);
+            ++next;
+        }
+        if (s.sweep != PARAM_COUNT) {
+            float position = static_cast<float>(frame) / total;
+            engine->setParameter(s.sweep, s.sweepFrom + (s.sweepTo - s.sweepFrom) * position);
+        }
+        uint64_t end = std::min<uint64_t>(frame + BLOCK_FRAMES, total);
+        if (next < changes.size()) end = std::min(end, changes[next].frame);
+        engine->render(out.data() + frame, static_cast<unsigned int>(end - frame), 1);
+        frame = end;
+    }
+    return out;
+}
+
+static bool writeReference(const std::string& path, const std::vector<float>& samples) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = writeWavHeader(file, SAMPLE_RATE, 1, 32, true, 0);
+    ok = ok && std::fwrite(samples.data(), sizeof(float), samples.size(), file) == samples.size();
+    ok = ok && writeWavHeader(file, SAMPLE_RATE, 1, 32, true, samples.size() * sizeof(float));
+    return std::fclose(file) == 0 && ok;
+}
+
+static void fft(std::vector<std::complex<double>>& x) {
+    size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(x[i], x[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        std::complex<double> step = std::polar(1.0, -2.0 * M_PI / len);
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0);
+            for (size_t k = 0; k < len / 2; ++k) {
+                std::complex<double> a = x[i + k];
+                std::complex<double> b = x[i + k + len / 2] * w;
+                x[i + k] = a + b;
+                x[i + k + len / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+}
+
+static void magnitudes(const std::vector<float>& samples, size_t start, std::vector<double>& out) {
+    std::vector<std::complex<double>> x(FFT_SIZE);
+    for (size_t i = 0; i < FFT_SIZE; ++i) {
+        double window = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / FFT_SIZE);
+        x[i] = start + i < samples.size() ? samples[start + i] * window : 0.0;
+    }
+    fft(x);
+    out.resize(FFT_SIZE / 2 + 1);
+    for (size_t k = 0; k < out.size(); ++k) out[k] = std::abs(x[k]);
+}
+
+// Worst log spectral distance in dB over half-overlapping Hann frames. Bins
+// more than 60 dB below the frame's peak are floored, so noise down there
+// doesn't count.
+static double spectralDistance(const std::vector<float>& reference, const std::vector<float>& rendered) {
+    std::vector<double> r, t;
+    double worst = 0.0;
+    for (size_t start = 0; start < reference.size(); start += FFT_SIZE / 2) {
+        magnitudes(reference, start, r);
+        magnitudes(rendered, start, t);
+        double peak = std::max(*std::max_element(r.begin(), r.end()), *std::max_element(t.begin(), t.end()));
+        if (peak < SILENT_MAGNITUDE) continue;
+        double floor = peak * 1.0e-3;
+        double sum = 0.0;
+        for (size_t k = 0; k < r.size(); ++k) {
+            double db = 20.0 * std::log10((t[k] + floor) / (r[k] + floor));
+            sum += db * db;
+        }
+        worst = std::max(worst, std::sqrt(sum / r.size()));
+    }
+    return worst;
+}
+
+static bool compareScenario(const std::string& path, const std::vector<float>& rendered, const GoldenSettings& settings) {
+    unsigned int rate = 0, channels = 0;
+    std::vector<float> reference;
+    std::string error;
+    if (!readFloatWav(path, rate, channels, reference, error)) {
+        std::cout << error << ", write the references with --golden-update" << std::endl;
+        return false;
+    }
+    if (rate != SAMPLE_RATE || channels != 1 || reference.size() != rendered.size()) {
+        std::cout << "reference is " << reference.size() << " frames of " << channels << " channels at " << rate
+                  << " Hz, rendered " << rendered.size() << " mono at " << SAMPLE_RATE << " Hz: FAILED" << std::endl;
+        return false;
+    }
+
+    float maxDiff = 0.0f;
+    size_t maxFrame = 0;
+    for (size_t i = 0; i < rendered.size(); ++i) {
+        float diff = std::fabs(rendered[i] - reference[i]);
+        // a NaN anywhere is a failure, not a zero difference
+        if (!(diff <= maxDiff)) {
+            maxDiff = std::isnan(diff) ? INFINITY : diff;
+            maxFrame = i;
+        }
+    }
+    double spectral = spectralDistance(reference, rendered);
+    bool ok = maxDiff <= settings.sampleTolerance && spectral <= settings.spectralToleranceDb;
+    std::cout << std::scientific << std::setprecision(1) << "max diff " << maxDiff << " (frame " << maxFrame << "), "
+              << std::fixed << std::setprecision(2) << "spectral " << spectral << " dB: " << (ok ? "ok" : "FAILED")
+              << std::endl;
+    return ok;
+}
+
+// Not a recording: all sound off in the middle of a note, then the same
+// note again, which has to come back up to the patch's sustain level
+static bool checkKillKeepsSustain() {
+    static const float SUSTAIN = 0.6f;
+    SynthConfig config;
+    config.sampleRate = SAMPLE_RATE;
+    config.maxFrames = BLOCK_FRAMES;
+    config.voices = 1;
+    Synth synth(config);
+    SynthEngine* engine = synth.getEngine();
+    engine->getGovernor().setEnabled(false);
+    engine->setParameter(PARAM_AEG_ATTACK, 0.005f);
+    engine->setParameter(PARAM_AEG_DECAY, 0.02f);
+    engine->setParameter(PARAM_AEG_SUSTAIN, SUSTAIN);
+
+    std::vector<float> out(BLOCK_FRAMES);
+    auto renderFor = [&](double seconds) {
+        for (long n = std::lround(seconds * SAMPLE_RATE / BLOCK_FRAMES); n > 0; --n) {
+            engine->render(out.data(), BLOCK_FRAMES, 1);
+        }
+    };
+    GoldenNote note = {0.0, 0.0, 57, 100};
+    pushNote(engine, EVENT_NOTE_ON, note);
+    renderFor(0.1);
+    SynthEvent killEvent = {};
+    killEvent.type = EVENT_ALL_SOUND_OFF;
+    engine->pushEvent(killEvent);
+    renderFor(0.01);
+    pushNote(engine, EVENT_NOTE_ON, note);
+    renderFor(0.1);
+
+    float level = synth.getVoices()[0]->envelopeLevel();
+    std::cout << "kill-keeps-sustain: ";
+    if (std::fabs(level - SUSTAIN) > 1.0e-3f) {
+        std::cout << "FAILED, envelope at " << level << " instead of " << SUSTAIN << std::endl;
+        return false;
+    }
+    std::cout << "ok" << std::endl;
+    return true;
+}
+
+int runGolden(const GoldenSettings& settings) {
+    std::vector<GoldenScenario> scenarios = buildScenarios();
+    int failed = 0;
+    int run = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const GoldenScenario& s : scenarios) {
+        if (!settings.only.empty() && s.name.find(settings.only) == std::string::npos) continue;
+        ++run;
+        std::string path = settings.directory + "/" + s.name + ".wav";
+        std::vector<float> rendered = renderScenario(s);
+        std::cout << s.name << ": ";
+        if (settings.update) {
+            if (writeReference(path, rendered)) {
+                std::cout << "wrote " << path << std::endl;
+            }
+            else {
+                std::cout << "could not write " << path << std::endl;
+                ++failed;
+            }
+        }
+        else if (!compareScenario(path, rendered, settings)) {
+            ++failed;
+        }
+    }
+    std::string killCheck = "kill-keeps-sustain";
+    if (!settings.update && killCheck.find(settings.only) != std::string::npos) {
+        ++run;
+        if (!checkKillKeepsSustain()) ++failed;
+    }
+    if (run == 0) {
+        std::cout << "no scenario matches \"" << settings.only << "\"" << std::endl;
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::fixed << std::setprecision(1) << run << " scenarios, " << failed << " failed ("
+              << elapsed.count() << " s)" << std::endl;
+    return failed;
+}
@@ -0,0 +1,26 @@
+#ifndef GOLDENRENDER_H
+#define GOLDENRENDER_H
+
+#include <string>
+
+// Regression check for the sound. A fixed set of scenarios (note patterns on
+// every waveform pair at every quality tier, so both filter models and both
+// oscillator backends, plus knob sweeps) is rendered headless from a fresh
+// engine with the governor off, so the same build always produces the same
+// samples. Each one is compared against <directory>/<scenario>.wav. A few
+// behaviours that don't need a recording are checked directly alongside.
+//
+// Run it before and after touching the voice / filter path: write the
+// references with update = true on the old code, then compare on the new.
+struct GoldenSettings {
+    std::string directory;
+    bool update = false;            // write the references instead of comparing
+    std::string only;               // run only the scenarios whose name contains this
+    float sampleTolerance = 1.0e-4f;    // largest per-sample difference allowed
+    float spectralToleranceDb = 0.5f;   // largest log spectral distance of any frame
+};
+
+// Returns the number of scenarios that failed (missing references count)
+int runGolden(const GoldenSettings& settings);
+
+#endif
@@ -0,0 +1,103 @@
+#include "governor.h"
+#include <sstream>
+
+constexpr double PolyphonyGovernor::ESCALATE_LOAD;
+constexpr double PolyphonyGovernor::RECOVER_LOAD;
+
+const char* PolyphonyGovernor::stageName(Stage stage) {
+    switch (stage) {
+        case NORMAL: return "normal";
+        case STEAL_TAILS: return "steal tails";
+        case CHEAP_KERNELS: return "cheap kernels";
+        case CAP_POLYPHONY: return "cap polyphony";
+        default: break;
+    }
+    return "unknown";
+}
+
+PolyphonyGovernor::PolyphonyGovernor() {
+    stage.store(NORMAL);
+    escalations.store(0);
+    recoveries.store(0);
+    tailsStolen.store(0);
+    notesDropped.store(0);
+    voiceLimit.store(0);
+    for (int i = 0; i < STAGE_COUNT; ++i) blocksInStage[i].store(0);
+}
+
+bool PolyphonyGovernor::update(uint64_t renderNs, uint64_t budgetNs) {
+    double load = budgetNs > 0 ? static_cast<double>(renderNs) / budgetNs : 0.0;
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    int current = stage.load(relaxed);
+    blocksInStage[current].store(blocksInStage[current].load(relaxed) + 1, relaxed);
+    if (!enabled) return false;
+
+    if (settle > 0) --settle;
+
+    if (load > ESCALATE_LOAD) {
+        calmNs = 0;
+        if (settle > 0 && load <= 1.0) return false;
+        settle = SETTLE_BLOCKS;
+        escalations.store(escalations.load(relaxed) + 1, relaxed);
+        if (current + 1 < STAGE_COUNT) {
+            stage.store(current + 1, relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    if (load < RECOVER_LOAD && current > NORMAL) {
+        calmNs += budgetNs;
+        if (calmNs >= RECOVER_NS) {
+            calmNs = 0;
+            stage.store(current - 1, relaxed);
+            recoveries.store(recoveries.load(relaxed) + 1, relaxed);
+        }
+    }
+    else {
+        calmNs = 0;
+    }
+    return false;
+}
+
+void PolyphonyGovernor::countTailsStolen(int n) {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    tailsStolen.store(tailsStolen.load(relaxed) + n, relaxed);
+}
+
+PolyphonyGovernor::Snapshot PolyphonyGovernor::snapshot() const {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    Snapshot s;
+    s.stage = getStage();
+    s.escalations = escalations.load(relaxed);
+    s.recoveries = recoveries.load(relaxed);
+    s.tailsStolen = tailsStolen.load(relaxed);
+    s.notesDropped = notesDropped.load(relaxed);
+    s.voiceLimit = voiceLimit.load(relaxed);
+    for (int i = 0; i < STAGE_COUNT; ++i) s.blocksInStage[i] = blocksInStage[i].load(relaxed);
+    return s;
+}
+
+std::string PolyphonyGovernor::toText(const Snapshot& s) {
+    std::ostringstream out;
+    out << "governor: " << stageName(s.stage)
+        << " | escalations " << s.escalations << " recoveries " << s.recoveries
+        << " | tails stolen " << s.tailsStolen << " notes dropped " << s.notesDropped
+        << " | voice limit " << s.voiceLimit << " | blocks per stage";
+    for (int i = 0; i < STAGE_COUNT; ++i) out << " " << s.blocksInStage[i];
+    return out.str();
+}
+
+std::string PolyphonyGovernor::toJson(const Snapshot& s) {
+    std::ostringstream out;
+    out << "{\"stage\":\"" << stageName(s.stage) << "\""
+        << ",\"escalations\":" << s.escalations
+        << ",\"recoveries\":" << s.recoveries
+        << ",\"tails_stolen\":" << s.tailsStolen
+        << ",\"notes_dropped\":" << s.notesDropped
+        << ",\"voice_limit\":" << s.voiceLimit
+        << ",\"blocks_in_stage\":[";
+    for (int i = 0; i < STAGE_COUNT; ++i) out << (i ? "," : "") << s.blocksInStage[i];
+    out << "]}";
+    return out.str();
+}
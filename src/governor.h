@@ -0,0 +1,81 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Watches the load of every block and backs the engine off in stages before
+// it runs out of time, then eases back once the load has stayed low for a while.
+//
+//   STEAL_TAILS     released voices that are nearly silent are cut off
+//   CHEAP_KERNELS   filters switch to the rational tanh approximation
+//   CAP_POLYPHONY   new notes may only take over releasing voices, and the
+//                   cap drops by one every time the load is still too high
+//
+// update() runs on the audio thread; the counters can be read from anywhere.
+class PolyphonyGovernor {
+public:
+    enum Stage {
+        NORMAL,
+        STEAL_TAILS,
+        CHEAP_KERNELS,
+        CAP_POLYPHONY,
+        STAGE_COUNT
+    };
+
+    struct Snapshot {
+        Stage stage;
+        uint64_t escalations;
+        uint64_t recoveries;
+        uint64_t tailsStolen;
+        uint64_t notesDropped;
+        int voiceLimit;
+        uint64_t blocksInStage[STAGE_COUNT];
+    };
+
+    static const char* stageName(Stage stage);
+
+    PolyphonyGovernor();
+
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() const { return enabled; }
+
+    // Feed the timing of the block just rendered. Returns true if the
+    // governor wants one more notch of relief while already at the last
+    // stage, i.e. the polyphony cap should come down.
+    bool update(uint64_t renderNs, uint64_t budgetNs);
+    Stage getStage() const { return static_cast<Stage>(stage.load(std::memory_order_relaxed)); }
+
+    // audio thread, bookkeeping for what the engine did
+    void countTailsStolen(int n);
+    void setNotesDropped(uint64_t n) { notesDropped.store(n, std::memory_order_relaxed); }
+    void setVoiceLimit(int limit) { voiceLimit.store(limit, std::memory_order_relaxed); }
+
+    Snapshot snapshot() const;
+    static std::string toText(const Snapshot& s);
+    static std::string toJson(const Snapshot& s);
+
+private:
+    // above this the next stage kicks in, above 1.0 we have already missed the deadline
+    static constexpr double ESCALATE_LOAD = 0.8;
+    static constexpr double RECOVER_LOAD = 0.5;
+    // blocks to wait after escalating before escalating again, unless a deadline was missed
+    static const int SETTLE_BLOCKS = 4;
+    // audio time in a row under RECOVER_LOAD before stepping back one stage,
+    // in time rather than blocks so it doesn't depend on the buffer size
+    static const uint64_t RECOVER_NS = 2000000000ull;
+
+    bool enabled = true;
+    int settle = 0;
+    uint64_t calmNs = 0;
+    std::atomic<int> stage;
+    std::atomic<uint64_t> escalations;
+    std::atomic<uint64_t> recoveries;
+    std::atomic<uint64_t> tailsStolen;
+    std::atomic<uint64_t> notesDropped;
+    std::atomic<int> voiceLimit;
+    std::atomic<uint64_t> blocksInStage[STAGE_COUNT];
+};
+
+#endif
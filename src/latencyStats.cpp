@@ -0,0 +1,84 @@
+#include "latencyStats.h"
+#include <sstream>
+#include <iomanip>
+
+LatencyStats::LatencyStats() {
+    notes.store(0);
+    minNs.store(UINT64_MAX);
+    maxNs.store(0);
+    lastQueueNs.store(0);
+    lastDeviceNs.store(0);
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) histogram[i].store(0);
+}
+
+void LatencyStats::record(uint64_t totalNs, uint64_t queueNs, uint64_t deviceNs) {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    uint64_t bin = totalNs / (BIN_MICROSECONDS * 1000);
+    if (bin >= HISTOGRAM_BINS) bin = HISTOGRAM_BINS - 1;
+
+    // single writer
+    histogram[bin].store(histogram[bin].load(relaxed) + 1, relaxed);
+    if (totalNs < minNs.load(relaxed)) minNs.store(totalNs, relaxed);
+    if (totalNs > maxNs.load(relaxed)) maxNs.store(totalNs, relaxed);
+    lastQueueNs.store(queueNs, relaxed);
+    lastDeviceNs.store(deviceNs, relaxed);
+    notes.store(notes.load(relaxed) + 1, std::memory_order_release);
+}
+
+// Upper edge of the bin holding the requested fraction of the notes
+double LatencyStats::percentile(double fraction, uint64_t total) const {
+    if (total == 0) return 0.0;
+    uint64_t threshold = static_cast<uint64_t>(fraction * total);
+    if (threshold == 0) threshold = 1;
+    uint64_t running = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        running += histogram[i].load(std::memory_order_relaxed);
+        if (running >= threshold) return (i + 1) * BIN_MICROSECONDS / 1000.0;
+    }
+    return HISTOGRAM_BINS * BIN_MICROSECONDS / 1000.0;
+}
+
+LatencyStats::Snapshot LatencyStats::snapshot() const {
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    Snapshot s;
+    s.notes = notes.load(std::memory_order_acquire);
+    uint64_t lowest = minNs.load(relaxed);
+    s.minMs = s.notes > 0 ? lowest / 1.0e6 : 0.0;
+    s.maxMs = maxNs.load(relaxed) / 1.0e6;
+
+    uint64_t total = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) total += histogram[i].load(relaxed);
+    s.p50Ms = percentile(0.50, total);
+    s.p90Ms = percentile(0.90, total);
+    s.p99Ms = percentile(0.99, total);
+    if (s.p50Ms > s.maxMs) s.p50Ms = s.maxMs;
+    if (s.p90Ms > s.maxMs) s.p90Ms = s.maxMs;
+    if (s.p99Ms > s.maxMs) s.p99Ms = s.maxMs;
+
+    s.lastQueueMs = lastQueueNs.load(relaxed) / 1.0e6;
+    s.lastDeviceMs = lastDeviceNs.load(relaxed) / 1.0e6;
+    return s;
+}
+
+std::string LatencyStats::toText(const Snapshot& s) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << "note latency (" << s.notes << " notes): min " << s.minMs << " p50 " << s.p50Ms
+        << " p90 " << s.p90Ms << " p99 " << s.p99Ms << " max " << s.maxMs << " ms"
+        << " | last: queue " << s.lastQueueMs << " + device " << s.lastDeviceMs << " ms";
+    return out.str();
+}
+
+std::string LatencyStats::toJson(const Snapshot& s) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3)
+        << "{\"notes\":" << s.notes
+        << ",\"min_ms\":" << s.minMs
+        << ",\"p50_ms\":" << s.p50Ms
+        << ",\"p90_ms\":" << s.p90Ms
+        << ",\"p99_ms\":" << s.p99Ms
+        << ",\"max_ms\":" << s.maxMs
+        << ",\"last_queue_ms\":" << s.lastQueueMs
+        << ",\"last_device_ms\":" << s.lastDeviceMs << "}";
+    return out.str();
+}
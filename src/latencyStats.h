@@ -0,0 +1,49 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Note-on to sound latency: from the moment midiCallback saw the note-on to the
+// estimated time the voice's first non-silent sample leaves the device.
+// With several MIDI inputs the queue part includes up to 0.5 ms waiting for
+// the merge thread's next poll (MidiReader), on top of the block boundary.
+// Written by the audio thread only, read by anyone.
+class LatencyStats {
+public:
+    static const int HISTOGRAM_BINS = 400;      // 0.25 ms wide, last bin collects >= 99.75 ms
+    static const int BIN_MICROSECONDS = 250;
+
+    struct Snapshot {
+        uint64_t notes;
+        double minMs;
+        double p50Ms;
+        double p90Ms;
+        double p99Ms;
+        double maxMs;
+        double lastQueueMs;    // receive -> start of the block that played it
+        double lastDeviceMs;   // block start -> estimated device output
+    };
+
+    LatencyStats();
+
+    // audio thread
+    void record(uint64_t totalNs, uint64_t queueNs, uint64_t deviceNs);
+
+    Snapshot snapshot() const;
+    static std::string toText(const Snapshot& s);
+    static std::string toJson(const Snapshot& s);
+
+private:
+    double percentile(double fraction, uint64_t total) const;
+
+    std::atomic<uint64_t> notes;
+    std::atomic<uint64_t> minNs;
+    std::atomic<uint64_t> maxNs;
+    std::atomic<uint64_t> lastQueueNs;
+    std::atomic<uint64_t> lastDeviceNs;
+    std::atomic<uint32_t> histogram[HISTOGRAM_BINS];
+};
+
+#endif
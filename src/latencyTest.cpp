@@ -0,0 +1,68 @@
+#include "latencyTest.h"
+#include "stk/RtMidi.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+static const int NOTE_LENGTH_MS = 40;
+static const int NOTE_GAP_MS = 60;
+static const int JITTER_MS = 15;
+
+bool runLatencyLoopback(const std::string& portName, int nNotes, const std::atomic<bool>& running) {
+    RtMidiOut* midi_out = nullptr;
+    try {
+        midi_out = new RtMidiOut();
+    }
+    catch (RtMidiError& e) {
+        e.printMessage();
+        return false;
+    }
+
+    // the virtual port can take a moment to show up
+    int found = -1;
+    for (int attempt = 0; attempt < 20 && found < 0; ++attempt) {
+        unsigned int nPorts = midi_out->getPortCount();
+        for (unsigned int i = 0; i < nPorts; ++i) {
+            if (midi_out->getPortName(i).find(portName) != std::string::npos) {
+                found = static_cast<int>(i);
+                break;
+            }
+        }
+        if (found < 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (found < 0) {
+        std::cerr << "Latency test: MIDI port \"" << portName << "\" not found" << std::endl;
+        delete midi_out;
+        return false;
+    }
+
+    try {
+        midi_out->openPort(found);
+    }
+    catch (RtMidiError& e) {
+        e.printMessage();
+        delete midi_out;
+        return false;
+    }
+
+    std::cout << "Latency test: playing " << nNotes << " notes" << std::endl;
+    std::minstd_rand random(12345);
+    std::uniform_int_distribution<int> jitter(0, JITTER_MS);
+    std::vector<unsigned char> message(3);
+    for (int i = 0; i < nNotes && running.load(); ++i) {
+        message[0] = 0x90;
+        message[1] = static_cast<unsigned char>(48 + i % 24);
+        message[2] = 100;
+        midi_out->sendMessage(&message);
+        std::this_thread::sleep_for(std::chrono::milliseconds(NOTE_LENGTH_MS));
+
+        message[0] = 0x80;
+        message[2] = 0;
+        midi_out->sendMessage(&message);
+        std::this_thread::sleep_for(std::chrono::milliseconds(NOTE_GAP_MS + jitter(random)));
+    }
+
+    delete midi_out;
+    return true;
+}
@@ -0,0 +1,13 @@
+#ifndef LATENCYTEST_H
+#define LATENCYTEST_H
+
+#include <atomic>
+#include <string>
+
+// Plays nNotes note-on/off pairs into the synth's own virtual MIDI input, so the
+// note latency statistics fill up without a keyboard attached. The gaps between
+// notes are jittered so the note-ons land at different points of the audio block.
+// Returns false if the virtual port couldn't be found.
+bool runLatencyLoopback(const std::string& portName, int nNotes, const std::atomic<bool>& running);
+
+#endif
@@ -0,0 +1,115 @@
+#include "loadGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// The knobs that move continuously on a real controller
+static const SynthParam AUTOMATED[] = {
+    PARAM_CUTOFF, PARAM_RESONANCE, PARAM_FEG_AMOUNT, PARAM_XMOD, PARAM_OSC2_TUNE, PARAM_OSC1_VOLUME, PARAM_OSC2_VOLUME,
+};
+static const int AUTOMATED_COUNT = sizeof(AUTOMATED) / sizeof(AUTOMATED[0]);
+static const int PITCH_TRIES = 8;
+static const int REALTIME_TICK_MS = 1;
+
+LoadGenerator::LoadGenerator(SynthEngine* engine, const LoadSettings& settings)
+    : engine(engine), settings(settings), random(settings.seed) {
+    this->settings.chordSize = std::max(1, settings.chordSize);
+    this->settings.pitchSpread = std::max(1, std::min(settings.pitchSpread, 127 - settings.lowestNote));
+    held.reserve(SynthEngine::EVENT_QUEUE_SIZE);
+}
+
+double LoadGenerator::jitter(double mean) {
+    return mean * (0.5 + static_cast<double>(random() - random.min()) / (random.max() - random.min()));
+}
+
+bool LoadGenerator::isHeld(int note) const {
+    for (const HeldNote& h : held) {
+        if (h.note == note) return true;
+    }
+    return false;
+}
+
+// The allocator finds voices by pitch, so a pitch already held is skipped
+// rather than doubled
+void LoadGenerator::startChord(double now) {
+    for (int i = 0; i < settings.chordSize && held.size() < held.capacity(); ++i) {
+        int note = -1;
+        for (int t = 0; t < PITCH_TRIES && note < 0; ++t) {
+            int candidate = settings.lowestNote + static_cast<int>(random() % (settings.pitchSpread + 1));
+            if (!isHeld(candidate)) note = candidate;
+        }
+        if (note < 0) continue;
+        SynthEvent event = {};
+        event.type = EVENT_NOTE_ON;
+        event.note = static_cast<uint8_t>(note);
+        event.velocity = static_cast<uint8_t>(40 + random() % 88);
+        event.receivedNs = steadyNowNs();
+        if (!engine->pushEvent(event)) {
+            ++dropped;
+            continue;
+        }
+        held.push_back({now + jitter(settings.sustainSeconds), event.note});
+        ++notesPlayed;
+    }
+}
+
+void LoadGenerator::moveKnob() {
+    SynthParam param = AUTOMATED[random() % AUTOMATED_COUNT];
+    const SynthParamInfo& info = synthParamInfo(param);
+    float position = static_cast<float>(random() - random.min()) / (random.max() - random.min());
+    if (engine->setParameter(param, info.min + (info.max - info.min) * position)) ++knobChanges;
+    else ++dropped;
+}
+
+void LoadGenerator::advanceTo(double seconds) {
+    // note-offs first, a note-off that doesn't fit stays held and is tried again next time
+    for (size_t i = 0; i < held.size();) {
+        if (held[i].off > seconds) {
+            ++i;
+            continue;
+        }
+        SynthEvent event = {};
+        event.type = EVENT_NOTE_OFF;
+        event.note = held[i].note;
+        if (!engine->pushEvent(event)) {
+            ++dropped;
+            break;
+        }
+        held[i] = held.back();
+        held.pop_back();
+    }
+    if (settings.chordsPerSecond > 0) {
+        while (nextChord <= seconds) {
+            startChord(nextChord);
+            nextChord += jitter(1.0 / settings.chordsPerSecond);
+        }
+    }
+    if (settings.knobChangesPerSecond > 0) {
+        while (nextKnob <= seconds) {
+            moveKnob();
+            nextKnob += jitter(1.0 / settings.knobChangesPerSecond);
+        }
+    }
+}
+
+void LoadGenerator::releaseAll() {
+    for (HeldNote& h : held) h.off = 0.0;
+    advanceTo(0.0);
+}
+
+void runLoadGenerator(SynthEngine* engine, const LoadSettings& settings, const std::atomic<bool>& running) {
+    std::cout << "Load: chords of " << settings.chordSize << " at " << settings.chordsPerSecond << "/s, held "
+              << settings.sustainSeconds << " s, over " << settings.pitchSpread << " semitones, "
+              << settings.knobChangesPerSecond << " knob moves/s" << std::endl;
+    LoadGenerator generator(engine, settings);
+    auto start = std::chrono::steady_clock::now();
+    while (running.load()) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        generator.advanceTo(elapsed.count());
+        std::this_thread::sleep_for(std::chrono::milliseconds(REALTIME_TICK_MS));
+    }
+    generator.releaseAll();
+    std::cout << "Load: played " << generator.getNotesPlayed() << " notes and " << generator.getKnobChanges()
+              << " knob moves, " << generator.getDropped() << " events didn't fit in the queues" << std::endl;
+}
@@ -0,0 +1,66 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include "synthEngine.h"
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+struct LoadSettings {
+    int chordSize = 3;                  // notes started together
+    double chordsPerSecond = 2.0;
+    double sustainSeconds = 1.0;        // average hold, each note gets 0.5x to 1.5x of it
+    int lowestNote = 36;
+    int pitchSpread = 36;               // semitones above lowestNote the notes land in
+    double knobChangesPerSecond = 10.0; // 0 = leave the parameters alone
+    uint32_t seed = 1;
+};
+
+// Plays random chords and knob moves into an engine through pushEvent() and
+// setParameter(), the queues the MIDI callback and the GUI use. The caller
+// decides what time it is, so the same generator can run against the wall
+// clock or flat out against the audio clock. It is the producer of both
+// queues: nothing else may push notes or set parameters while it runs.
+class LoadGenerator {
+public:
+    LoadGenerator(SynthEngine* engine, const LoadSettings& settings);
+
+    // Pushes everything due up to `seconds` since the start
+    void advanceTo(double seconds);
+    // Note-offs for everything still held
+    void releaseAll();
+
+    int getHeldNotes() const { return static_cast<int>(held.size()); }
+    uint64_t getNotesPlayed() const { return notesPlayed; }
+    uint64_t getKnobChanges() const { return knobChanges; }
+    // Events the queues had no room for
+    uint64_t getDropped() const { return dropped; }
+
+private:
+    struct HeldNote {
+        double off;
+        uint8_t note;
+    };
+
+    void startChord(double now);
+    void moveKnob();
+    bool isHeld(int note) const;
+    double jitter(double mean);
+
+    SynthEngine* engine;
+    LoadSettings settings;
+    std::minstd_rand random;
+    std::vector<HeldNote> held;
+    double nextChord = 0.0;
+    double nextKnob = 0.0;
+    uint64_t notesPlayed = 0;
+    uint64_t knobChanges = 0;
+    uint64_t dropped = 0;
+};
+
+// Headless: plays the load in real time against the wall clock until running
+// goes false, then lets go of the notes and prints what it played.
+void runLoadGenerator(SynthEngine* engine, const LoadSettings& settings, const std::atomic<bool>& running);
+
+#endif
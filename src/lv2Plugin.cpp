@@ -0,0 +1,214 @@
+// LV2 instrument wrapping the engine, built with `make lv2` into new_synth.lv2/.
+// The port layout has to match new_synth.lv2/new_synth.ttl.
+//
+// Everything the engine needs is allocated in instantiate(); run() only
+// renders, so it is safe in a real-time host thread. MIDI is sample accurate:
+// the block is rendered up to each event's frame before the event is applied.
+// Control ports can only change between run() calls, their new values take
+// effect from the first frame of the block.
+
+#include "synth.h"
+#include "midiDispatch.h"
+#include "synthEvent.h"
+#include "synthParameters.h"
+#include "lv2/core/lv2.h"
+#include "lv2/atom/atom.h"
+#include "lv2/atom/util.h"
+#include "lv2/midi/midi.h"
+#include "lv2/urid/urid.h"
+#include "lv2/options/options.h"
+#include "lv2/buf-size/buf-size.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#define NEW_SYNTH_URI "urn:new_synth:synth"
+
+enum PortIndex {
+    PORT_MIDI_IN = 0,
+    PORT_OUT_LEFT = 1,
+    PORT_OUT_RIGHT = 2,
+    PORT_QUALITY = 3,
+    PORT_FIRST_PARAM = 4        // then one port per SynthParam, in enum order
+};
+
+// Without a maxBlockLength from the host we render in chunks of this
+static const unsigned int DEFAULT_MAX_FRAMES = 1024;
+
+// Stk keeps one sample rate for the whole process: the ADSRs and the Blit
+// oscillators read Stk::sampleRate(), and so does the polyBLEP backend's
+// phase increment, so every instance in a process has to run at the same
+// rate and a host asking for a second one gets no instance. Stk objects also
+// add and remove themselves on a static list when they are built and
+// destroyed, so building and destroying Synths happens under the mutex too.
+static std::mutex instancesMutex;
+static int instances = 0;
+static double instancesRate = 0.0;
+
+struct Lv2Synth {
+    std::unique_ptr<Synth> synth;
+    SynthEngine* engine = nullptr;
+    LV2_URID midiEvent = 0;
+    const LV2_Atom_Sequence* midiIn = nullptr;
+    MidiDispatch dispatch;
+    float* outLeft = nullptr;
+    float* outRight = nullptr;
+    const float* quality = nullptr;
+    const float* params[PARAM_COUNT] = {};
+    float lastParams[PARAM_COUNT];
+    int lastQuality = -1;
+    unsigned int maxFrames = DEFAULT_MAX_FRAMES;
+};
+
+static unsigned int maxBlockLength(const LV2_Options_Option* options, LV2_URID_Map* map) {
+    if (!options) return 0;
+    LV2_URID maxBlock = map->map(map->handle, LV2_BUF_SIZE__maxBlockLength);
+    LV2_URID atomInt = map->map(map->handle, LV2_ATOM__Int);
+    for (const LV2_Options_Option* o = options; o->key; ++o) {
+        if (o->key == maxBlock && o->type == atomInt) {
+            int32_t frames = *static_cast<const int32_t*>(o->value);
+            if (frames > 0) return static_cast<unsigned int>(frames);
+        }
+    }
+    return 0;
+}
+
+static LV2_Handle instantiate(const LV2_Descriptor* descriptor, double rate, const char* bundlePath,
+                              const LV2_Feature* const* features) {
+    LV2_URID_Map* map = nullptr;
+    const LV2_Options_Option* options = nullptr;
+    for (int i = 0; features && features[i]; ++i) {
+        if (std::strcmp(features[i]->URI, LV2_URID__map) == 0) map = static_cast<LV2_URID_Map*>(features[i]->data);
+        else if (std::strcmp(features[i]->URI, LV2_OPTIONS__options) == 0) {
+            options = static_cast<const LV2_Options_Option*>(features[i]->data);
+        }
+    }
+    if (!map) {
+        std::cerr << "new_synth: the host doesn't provide urid:map" << std::endl;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(instancesMutex);
+    if (instances > 0 && rate != instancesRate) {
+        std::cerr << "new_synth: all instances have to run at " << instancesRate << " Hz" << std::endl;
+        return nullptr;
+    }
+    ++instances;
+    instancesRate = rate;
+
+    Lv2Synth* plugin = new Lv2Synth();
+    plugin->midiEvent = map->map(map->handle, LV2_MIDI__MidiEvent);
+    unsigned int maxBlock = maxBlockLength(options, map);
+    if (maxBlock > 0 && maxBlock < DEFAULT_MAX_FRAMES) plugin->maxFrames = maxBlock;
+
+    SynthConfig config;
+    config.sampleRate = rate;
+    config.maxFrames = plugin->maxFrames;
+    plugin->synth.reset(new Synth(config));
+    plugin->engine = plugin->synth->getEngine();
+    // the block timing is the host's business, and offline renders have to
+    // come out the same every time
+    plugin->engine->getGovernor().setEnabled(false);
+    for (int p = 0; p < PARAM_COUNT; ++p) plugin->lastParams[p] = plugin->engine->getParameter(static_cast<SynthParam>(p));
+    return plugin;
+}
+
+static void connectPort(LV2_Handle instance, uint32_t port, void* data) {
+    Lv2Synth* plugin = static_cast<Lv2Synth*>(instance);
+    switch (port) {
+        case PORT_MIDI_IN: plugin->midiIn = static_cast<const LV2_Atom_Sequence*>(data); break;
+        case PORT_OUT_LEFT: plugin->outLeft = static_cast<float*>(data); break;
+        case PORT_OUT_RIGHT: plugin->outRight = static_cast<float*>(data); break;
+        case PORT_QUALITY: plugin->quality = static_cast<const float*>(data); break;
+        default:
+            if (port >= PORT_FIRST_PARAM && port < PORT_FIRST_PARAM + PARAM_COUNT) {
+                plugin->params[port - PORT_FIRST_PARAM] = static_cast<const float*>(data);
+            }
+            break;
+    }
+}
+
+static void applyControls(Lv2Synth* plugin) {
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (!plugin->params[p]) continue;
+        float value = *plugin->params[p];
+        if (value == plugin->lastParams[p]) continue;
+        plugin->engine->setParameter(static_cast<SynthParam>(p), value);
+        plugin->lastParams[p] = value;
+    }
+    if (plugin->quality) {
+        int tier = static_cast<int>(std::lround(*plugin->quality));
+        if (tier < 0) tier = 0;
+        if (tier >= QUALITY_TIER_COUNT) tier = QUALITY_TIER_COUNT - 1;
+        if (tier != plugin->lastQuality) {
+            plugin->engine->setQualityTier(static_cast<QualityTier>(tier));
+            plugin->lastQuality = tier;
+        }
+    }
+}
+
+// The engine renders mono straight into the left output, the right is a copy
+static void renderRange(Lv2Synth* plugin, uint32_t start, uint32_t end) {
+    while (start < end) {
+        uint32_t chunk = end - start;
+        if (chunk > plugin->maxFrames) chunk = plugin->maxFrames;
+        plugin->engine->render(plugin->outLeft + start, chunk, 1);
+        std::memcpy(plugin->outRight + start, plugin->outLeft + start, chunk * sizeof(float));
+        start += chunk;
+    }
+}
+
+static void handleMidi(Lv2Synth* plugin, const uint8_t* msg, uint32_t size) {
+    SynthEvent events[MidiDispatch::MAX_EVENTS];
+    int count = plugin->dispatch.translate(msg, size, events);
+    for (int i = 0; i < count; ++i) plugin->engine->pushEvent(events[i]);
+}
+
+static void run(LV2_Handle instance, uint32_t nFrames) {
+    Lv2Synth* plugin = static_cast<Lv2Synth*>(instance);
+    if (!plugin->outLeft || !plugin->outRight) return;
+    applyControls(plugin);
+
+    uint32_t done = 0;
+    if (plugin->midiIn) {
+        LV2_ATOM_SEQUENCE_FOREACH(plugin->midiIn, ev) {
+            if (ev->body.type != plugin->midiEvent) continue;
+            uint32_t frame = static_cast<uint32_t>(ev->time.frames);
+            if (frame > nFrames) frame = nFrames;
+            // the engine applies queued events at the start of its next block
+            if (frame > done) {
+                renderRange(plugin, done, frame);
+                done = frame;
+            }
+            handleMidi(plugin, reinterpret_cast<const uint8_t*>(ev + 1), ev->body.size);
+        }
+    }
+    renderRange(plugin, done, nFrames);
+}
+
+static void cleanup(LV2_Handle instance) {
+    std::lock_guard<std::mutex> lock(instancesMutex);
+    delete static_cast<Lv2Synth*>(instance);
+    --instances;
+}
+
+static const void* extensionData(const char* uri) {
+    return nullptr;
+}
+
+static const LV2_Descriptor descriptor = {
+    NEW_SYNTH_URI,
+    instantiate,
+    connectPort,
+    nullptr,        // activate
+    run,
+    nullptr,        // deactivate
+    cleanup,
+    extensionData
+};
+
+extern "C" LV2_SYMBOL_EXPORT const LV2_Descriptor* lv2_descriptor(uint32_t index) {
+    return index == 0 ? &descriptor : nullptr;
+}
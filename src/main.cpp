@@ -1,5 +1,4 @@
 #include "stk/SineWave.h"
-#include "stk/RtWvOut.h"
 
 #include "SDL2/SDL.h"
 #include "GL/glew.h"
@@ -11,23 +10,43 @@
 #include "toggleSwitch.h"
 #include "imageLoading.h"
 
-#include "voice.h"
-#include "voiceAllocator.h"
+#include "synth.h"
 #include "colors.h"
 #include "midiReader.h"
-
+#include "options.h"
+#include "realtime.h"
+#include "trace.h"
+#include "probes.h"
+#include "latencyTest.h"
+#include "benchmark.h"
+#include "audioSink.h"
+#include "recorder.h"
+#include "synthControl.h"
+#include "sharedControl.h"
+#include "batchRender.h"
+#include "goldenRender.h"
+#include "stressTest.h"
+#include "midiFilePlayer.h"
+#include "rtCheck.h"
+
+#include <algorithm>
+#include <csignal>
 #include <cstdlib>
+#include <ctime>
 #include <stdio.h>
 #include <thread>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 
 
-const double SAMPLERATE = 48000.0;
-const int BUFFER_FRAMES = 512;
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
+const char* const LATENCY_TEST_PORT = "new_synth latency test";
+const unsigned int DEFAULT_BENCHMARK_PROFILE_INTERVAL = 8;
+const size_t PREFAULT_STACK_BYTES = 256 * 1024;
+const size_t PREFAULT_HEAP_BYTES = 8 * 1024 * 1024;
 
 std::atomic<bool> running(true); // flag that is shared across threads
 
@@ -93,116 +112,115 @@ template <typename UpdateFunc>
 void createKnob(const char* label, float* value, float min, float max, float step, const char* format,
                 UpdateFunc updateFunc) {
     if (ImGuiKnobs::Knob(label, value, min, max, step, "", ImGuiKnobVariant_Wiper, KNOBSIZE, ImGuiKnobFlags_NoInput | ImGuiKnobFlags_NoTitle)) {
+        TraceSpan span("apply parameter");
+        SYNTH_PROBE1(param_apply, label);
         updateFunc(*value);
     }
 }
 
-struct adsrParameters {
-    float attackTime;
-    float decayTime;
-    float sustainLevel;
-    float releaseTime;
-};
-
-void renderUi(Voice* voices[], int nVoices) {
+// The knobs start from whatever the engine holds and hand every change to its
+// parameter queue, the voices are only touched from the audio thread
+void renderUi(SynthControl* control) {
 
     ImGui::SetNextWindowPos(ImVec2(0,0));
     ImGui::SetNextWindowSize(ImVec2(800,600));
     ImGui::Begin("UI", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoBackground);
 
     // OSC SECTION
-    static float osc1detune = 1.0f;
-    static float osc2detune = 1.0f;
-    static float osc1volume = 1.0f;
-    static float osc2volume = 1.0f;
-    static float xModAmount = 0.0f;
-    static bool toggle_value1 = false;
-    static bool toggle_value2 = false;
+    static float osc1detune = control->getParameter(PARAM_OSC1_TUNE);
+    static float osc2detune = control->getParameter(PARAM_OSC2_TUNE);
+    static float osc1volume = control->getParameter(PARAM_OSC1_VOLUME);
+    static float osc2volume = control->getParameter(PARAM_OSC2_VOLUME);
+    static float xModAmount = control->getParameter(PARAM_XMOD);
+    static bool toggle_value1 = control->getParameter(PARAM_OSC1_WAVEFORM) >= 0.5f;
+    static bool toggle_value2 = control->getParameter(PARAM_OSC2_WAVEFORM) >= 0.5f;
     ImGui::SetCursorPos(ImVec2(70, 108));
     createKnob("Osc1 tune", &osc1detune, 1.0/1.05946f, 1.05946f, 0.0001f, "%.3f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setOscDetune(1, v);
+        control->setParameter(PARAM_OSC1_TUNE, v);
     });
     ImGui::SetCursorPos(ImVec2(71, 162));
     createKnob("Osc2 tune", &osc2detune, 1.0/1.05946f, 1.05946f, 0.0001f, "%.3f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setOscDetune(2, v);
+        control->setParameter(PARAM_OSC2_TUNE, v);
     });
     ImGui::SetCursorPos(ImVec2(173, 127));
     if (ToggleSwitch("Toggle1", &toggle_value1)) {
-        for (int i = 0; i < nVoices; ++i) {
-            voices[i]->toggleOscWaveform(1, toggle_value1);
-        }
+        TraceSpan span("apply parameter");
+        SYNTH_PROBE1(param_apply, "Toggle1");
+        control->setParameter(PARAM_OSC1_WAVEFORM, toggle_value1 ? 1.0f : 0.0f);
     }
     ImGui::SetCursorPos(ImVec2(173, 182));
     if (ToggleSwitch("Toggle2", &toggle_value2)) {
-        for (int i = 0; i < nVoices; ++i) {
-            voices[i]->toggleOscWaveform(2, toggle_value2);
-        }
+        TraceSpan span("apply parameter");
+        SYNTH_PROBE1(param_apply, "Toggle2");
+        control->setParameter(PARAM_OSC2_WAVEFORM, toggle_value2 ? 1.0f : 0.0f);
     }
     ImGui::SetCursorPos(ImVec2(283, 109));
     createKnob("Osc1 volume", &osc1volume, 0.0f, 1.0f, 0.001f, "%.3f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setOscVolume(1, v);
+        control->setParameter(PARAM_OSC1_VOLUME, v);
     });
     ImGui::SetCursorPos(ImVec2(282, 161));
     createKnob("Osc2 volume", &osc2volume, 0.0f, 1.0f, 0.001f, "%.3f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setOscVolume(2, v);
+        control->setParameter(PARAM_OSC2_VOLUME, v);
     });
     ImGui::SetCursorPos(ImVec2(341, 140));
     createKnob("xmod amount", &xModAmount, 0.0f, 1.0f, 0.001f, "%.3f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setXModVolume(v);
+        control->setParameter(PARAM_XMOD, v);
     });
     // FILTER SECTION
-    static float cutoff = 1000.0f;
-    static float resonance = 0.0f;
-    static float fegAmount = 0.0f;
+    static float cutoff = control->getParameter(PARAM_CUTOFF);
+    static float resonance = control->getParameter(PARAM_RESONANCE);
+    static float fegAmount = control->getParameter(PARAM_FEG_AMOUNT);
     ImGui::SetCursorPos(ImVec2(447, 128));
     createKnob("Cutoff", &cutoff, 0.1f, 1000.0f, 0.1f, "%.1f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setCutoff(v);
+        control->setParameter(PARAM_CUTOFF, v);
     });
     ImGui::SetCursorPos(ImVec2(525, 125));
     createKnob("Resonance", &resonance, 0.1f, 10.0f, 0.001f, "%.3f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setResonance(v);
+        control->setParameter(PARAM_RESONANCE, v);
     });
     ImGui::SetCursorPos(ImVec2(598, 118));
     createKnob("FEG Amount", &fegAmount, 0.0f, 1000.0f, 0.1f, "%.2f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setFegAmount(fegAmount);
+        control->setParameter(PARAM_FEG_AMOUNT, v);
     });
 
     // AEG
-    static adsrParameters aeg = {0.001, 1.0, 1.0, 1.0};
+    static adsrParameters aeg = {control->getParameter(PARAM_AEG_ATTACK), control->getParameter(PARAM_AEG_DECAY),
+                                 control->getParameter(PARAM_AEG_SUSTAIN), control->getParameter(PARAM_AEG_RELEASE)};
     ImGui::SetCursorPos(ImVec2(123, 303));
     createKnob("aegAttack", &aeg.attackTime, 0.001f, 5.0f, 0.001f, "%.3fs", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setAegAttack(v);
+        control->setParameter(PARAM_AEG_ATTACK, v);
     });
     ImGui::SetCursorPos(ImVec2(182, 299));
     createKnob("aegDecay", &aeg.decayTime, 0.03f, 2.0f, 0.001f, "%.3fs", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setAegDecay(v);
+        control->setParameter(PARAM_AEG_DECAY, v);
     });
     ImGui::SetCursorPos(ImVec2(237, 291));
     createKnob("aegSustain", &aeg.sustainLevel, 0.0f, 1.0f, 0.001f, "%.2f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setAegSustain(v);
+        control->setParameter(PARAM_AEG_SUSTAIN, v);
     });
     ImGui::SetCursorPos(ImVec2(294, 297));
     createKnob("aegRelease", &aeg.releaseTime, 0.001f, 3.0f, 0.001f, "%.3fs", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setAegRelease(v);
+        control->setParameter(PARAM_AEG_RELEASE, v);
     });
 
     // FEG
-    static adsrParameters feg = {0.001, 1.0, 1.0, 1.0};
+    static adsrParameters feg = {control->getParameter(PARAM_FEG_ATTACK), control->getParameter(PARAM_FEG_DECAY),
+                                 control->getParameter(PARAM_FEG_SUSTAIN), control->getParameter(PARAM_FEG_RELEASE)};
     ImGui::SetCursorPos(ImVec2(124, 372));
     createKnob("fegAttack", &feg.attackTime, 0.001f, 5.0f, 0.001f, "%.3fs", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setFegAttack(v);
+        control->setParameter(PARAM_FEG_ATTACK, v);
     });
     ImGui::SetCursorPos(ImVec2(184, 372));
     createKnob("fegDecay", &feg.decayTime, 0.03f, 2.0f, 0.001f, "%.3fs", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setFegDecay(v);
+        control->setParameter(PARAM_FEG_DECAY, v);
     });
     ImGui::SetCursorPos(ImVec2(240, 362));
     createKnob("fegSustain", &feg.sustainLevel, 0.0f, 1.0f, 0.001f, "%.2f", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setFegSustain(v);
+        control->setParameter(PARAM_FEG_SUSTAIN, v);
     });
     ImGui::SetCursorPos(ImVec2(291, 364));
     createKnob("fegRelease", &feg.releaseTime, 0.001f, 3.0f, 0.001f, "%.3fs", [&](float v) {
-        for (int i = 0; i < nVoices; ++i) voices[i]->setFegRelease(v);
+        control->setParameter(PARAM_FEG_RELEASE, v);
     });
 
     ImGui::End();
@@ -210,7 +228,63 @@ void renderUi(Voice* voices[], int nVoices) {
 }
 
 
-int guiThread(Voice* voices[], int nVoices, voiceAllocator* allocator) {
+// Small corner window with the audio thread's timing, toggled with F1
+void renderStatsOverlay(const SynthControl::Status& status, const std::vector<CycleStats::Row>& cycles) {
+    const EngineStats::Snapshot& s = status.engine;
+    const LatencyStats::Snapshot& latency = status.latency;
+    const PolyphonyGovernor::Snapshot& governor = status.governor;
+    ImGui::SetNextWindowPos(ImVec2(WINDOW_WIDTH - 10, WINDOW_HEIGHT - 10), ImGuiCond_Always, ImVec2(1.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    ImGui::Begin("Engine stats", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize |
+                                          ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings);
+    ImGui::Text("load %5.1f%%  avg %5.1f%%", s.lastLoad, s.averageLoad);
+    ImGui::Text("p99  %5.1f%%  max %5.1f%%", s.p99Load, s.maxLoad);
+    ImGui::Text("render %.3f / %.3f ms", s.lastRenderMs, s.budgetMs);
+    ImGui::Text("xruns %llu  underflows %llu", (unsigned long long) s.xruns, (unsigned long long) s.underflows);
+    ImGui::Text("voices %d  quality %s", s.activeVoices, qualityTierName(status.quality));
+    ImGui::Text("note latency p50 %.1f p99 %.1f ms", latency.p50Ms, latency.p99Ms);
+    ImGui::Text("governor: %s, limit %d", PolyphonyGovernor::stageName(governor.stage), governor.voiceLimit);
+    ImGui::Text("  tails stolen %llu dropped %llu", (unsigned long long) governor.tailsStolen,
+                (unsigned long long) governor.notesDropped);
+
+    float bins[EngineStats::HISTOGRAM_BINS];
+    for (int i = 0; i < EngineStats::HISTOGRAM_BINS; ++i) bins[i] = static_cast<float>(s.histogram[i]);
+    ImGui::PlotHistogram("##load", bins, EngineStats::HISTOGRAM_BINS, 0, "load histogram", 0.0f, FLT_MAX, ImVec2(225, 40));
+
+    // only there when --profile-every is on
+    for (const CycleStats::Row& row : cycles) {
+        ImGui::Text("%s %s (%s/sample)", filterModelName(static_cast<FilterModel>(row.filterModel)),
+                    oscillatorTypeName(row.oscillatorType), CYCLE_COUNTER_UNIT);
+        ImGui::Text("  osc %.0f env %.0f coef %.0f filt %.0f", row.perSample[STAGE_OSCILLATOR],
+                    row.perSample[STAGE_ENVELOPE], row.perSample[STAGE_FILTER_COEFFICIENTS],
+                    row.perSample[STAGE_FILTER_PROCESS]);
+    }
+    ImGui::End();
+}
+
+// Record button in the top right corner, F4 does the same
+void renderRecordButton(SynthControl* control, const SynthControl::Status& s) {
+    ImGui::SetNextWindowPos(ImVec2(WINDOW_WIDTH - 10, 10), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.8f);
+    ImGui::Begin("Record", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize |
+                                    ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings |
+                                    ImGuiWindowFlags_NoTitleBar);
+    if (!control->isConnected()) ImGui::Text("engine not responding");
+    else if (ImGui::Button(s.recording ? "Stop" : "Record")) control->toggleRecording();
+    if (s.recording) {
+        ImGui::SameLine();
+        ImGui::Text("%.1f s", s.recordedSeconds);
+        if (s.recordOverruns > 0) ImGui::Text("overruns %llu", (unsigned long long) s.recordOverruns);
+    }
+    ImGui::End();
+}
+
+// The GUI runs the same whether the engine is in this process or a daemon
+int guiThread(SynthControl* control, const SynthOptions& options) {
+    RealtimeStatus rtStatus = setupRealtimeThread("gui", 0, options.guiCpu);
+    std::cout << rtStatus.describe("GUI") << std::endl;
+    if (traceEnabled()) traceRegisterThread("gui");
+
     SDLContext sdlContext;
     if (!initializeSDL(sdlContext)) return 1;
     initializeImGui(sdlContext);
@@ -221,15 +295,32 @@ int guiThread(Voice* voices[], int nVoices, voiceAllocator* allocator) {
     bool ret = LoadTextureFromFile("../assets/ui_v0.jpg", &my_image_texture, &my_image_width, &my_image_height);
     IM_ASSERT(ret);
 
+    bool showStats = options.statsOverlay;
     SDL_Event event;
     // imgui main loop
     while (running.load()) {
+        TraceSpan frameSpan("gui frame");
         // Poll SDL events
         while (SDL_PollEvent(&event)) {
             ImGui_ImplSDL2_ProcessEvent(&event);
             if (event.type == SDL_QUIT) {
                 running.store(false);
             }
+            else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F1) {
+                showStats = !showStats;
+            }
+            else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F4) {
+                control->toggleRecording();
+            }
+            else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                QualityTier next = static_cast<QualityTier>((control->status().quality + 1) % QUALITY_TIER_COUNT);
+                control->setQualityTier(next);
+                std::cout << "Quality: " << qualityTierName(next) << std::endl;
+            }
+            else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F2 && traceEnabled()) {
+                if (writeChromeTrace(options.tracePath)) std::cout << "Trace written to " << options.tracePath << std::endl;
+                else std::cerr << "Could not write trace to " << options.tracePath << std::endl;
+            }
             // else if (event.type == SDL_MOUSEBUTTONDOWN) {
             //     int mouseX = event.motion.x;
             //     // for (int i = 0; i < nVoices; ++i) {
@@ -268,7 +359,10 @@ int guiThread(Voice* voices[], int nVoices, voiceAllocator* allocator) {
         style.Colors[ImGuiCol_ButtonActive] = ImVec4(0.2f, 0.2f, 0.2f, 1.0f);
         style.Colors[ImGuiCol_Button] = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
 
-        renderUi(voices, nVoices);
+        SynthControl::Status status = control->status();
+        renderUi(control);
+        renderRecordButton(control, status);
+        if (showStats) renderStatsOverlay(status, control->cycleRows());
 
         // Rendering
         ImGui::Render();
@@ -290,68 +384,328 @@ int guiThread(Voice* voices[], int nVoices, voiceAllocator* allocator) {
     return 0;
 }
 
-void audioThread(Voice* voices[], int nVoices) {
-    Stk::setSampleRate(SAMPLERATE);
-    RtWvOut *dac = 0;
+struct AudioContext {
+    SynthEngine* engine;
+    Recorder* recorder;
+    const SynthOptions* options;
+    std::atomic<bool> threadReady{false};
+    RealtimeStatus rtStatus;
+    uint64_t framesLeft = 0;    // with --duration, frames still to render
+};
 
-    try {
-        dac = new RtWvOut( 2, SAMPLERATE, 0, BUFFER_FRAMES );
-    }
-    catch ( StkError & ) {
-        exit( 1 );
+// Runs on the sink's thread. The first call turns that thread into our
+// real-time audio thread; audioThread() reports the result.
+bool renderCallback(float* out, unsigned int nFrames, bool underflow, void* userData) {
+    AudioContext* context = static_cast<AudioContext*>(userData);
+    if (!context->threadReady.load(std::memory_order_relaxed)) {
+        context->rtStatus = setupRealtimeThread("audio", context->options->rtPriority, context->options->audioCpu);
+        if (traceEnabled()) traceRegisterThread("audio");
+        prefaultStack(PREFAULT_STACK_BYTES);
+        context->threadReady.store(true, std::memory_order_release);
     }
 
+    RtCheckScope realtime;
+    if (underflow) {
+        SYNTH_PROBE(underflow);
+        context->engine->getStats().recordUnderflow();
+        context->engine->getFlightRecorder().freeze("device underflow");
+    }
+    context->engine->render(out, nFrames, AudioSink::CHANNELS);
+    context->recorder->capture(out, nFrames);
 
+    if (context->options->durationSeconds > 0) {
+        if (context->framesLeft <= nFrames) return false;
+        context->framesLeft -= nFrames;
+    }
+    return running.load();
+}
 
+void audioThread(AudioSink* sink, AudioContext* context, Voice* voices[], int nVoices, unsigned int bufferFrames) {
     for (int i = 0; i < nVoices; ++i) {
         voices[i]->setFrequency(110.0 * (i+1));
     }
 
+    // Run every voice for a buffer's worth of (silent) samples so its
+    // oscillator, envelope and filter state is faulted in and cache-warm
+    std::vector<float> scratch(bufferFrames);
+    for (int i = 0; i < nVoices; ++i) {
+        voices[i]->render(scratch.data(), bufferFrames);
+    }
+
+    context->engine->setOutputLatency(sink->latencyFrames());
+    if (!sink->start()) {
+        running.store(false);
+        return;
+    }
+
+    bool reported = false;
+    while (running.load() && sink->isRunning()) {
+        if (!reported && context->threadReady.load(std::memory_order_acquire)) {
+            std::cout << context->rtStatus.describe("Audio") << std::endl;
+            reported = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    sink->stop();
+    // the sink may have stopped by itself (end of --duration, device gone)
+    running.store(false);
+}
+
+void statsThread(SynthEngine* engine, const MidiReader* reader, const SynthOptions& options) {
+    auto interval = std::chrono::duration<double>(options.statsInterval);
+    auto next = std::chrono::steady_clock::now() + interval;
     while (running.load()) {
-        try {
-            double outputSample = 0;
-            for (int i = 0; i < nVoices; ++i) {
-                outputSample += voices[i]->tick() / nVoices;
-            }
-            dac->tick(outputSample);
+        if (std::chrono::steady_clock::now() < next) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            continue;
+        }
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+        EngineStats::Snapshot snapshot = engine->getStats().snapshot();
+        LatencyStats::Snapshot latency = engine->getLatencyStats().snapshot();
+        PolyphonyGovernor::Snapshot governor = engine->getGovernor().snapshot();
+        uint64_t midiDropped = reader ? reader->getDroppedEvents() : 0;
+        if (options.statsJson) {
+            std::cout << "{\"engine\":" << EngineStats::toJson(snapshot)
+                      << ",\"latency\":" << LatencyStats::toJson(latency)
+                      << ",\"governor\":" << PolyphonyGovernor::toJson(governor)
+                      << ",\"midi_dropped\":" << midiDropped << "}" << std::endl;
         }
-        catch ( StkError & ) {
-            break;
+        else {
+            std::cout << EngineStats::toText(snapshot) << "\n" << LatencyStats::toText(latency)
+                      << "\n" << PolyphonyGovernor::toText(governor);
+            if (reader) std::cout << "\nMIDI: " << midiDropped << " events dropped";
+            std::cout << std::endl;
         }
     }
+}
 
-    delete dac;
+LoadSettings loadSettings(const SynthOptions& options) {
+    LoadSettings load;
+    load.chordSize = options.loadChord;
+    load.chordsPerSecond = options.loadRate;
+    load.sustainSeconds = options.loadSustain;
+    load.pitchSpread = options.loadSpread;
+    load.knobChangesPerSecond = options.loadKnobs;
+    return load;
+}
 
+// The command line adds to what the config file says
+bool midiSettings(const SynthOptions& options, MidiSettings& midi) {
+    if (!options.midiConfig.empty()) {
+        std::string error;
+        if (!loadMidiConfig(options.midiConfig, midi, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+    }
+    midi.inputs.insert(midi.inputs.end(), options.midiInputs.begin(), options.midiInputs.end());
+    if (!options.midiVirtual.empty()) midi.virtualPort = options.midiVirtual;
+    return true;
 }
 
-int main()
+void stopRunning(int) {
+    running.store(false);
+}
+
+int main(int argc, char* argv[])
 {
-    Voice* voice1 = new Voice(SAMPLERATE);
-    Voice* voice2 = new Voice(SAMPLERATE);
-    Voice* voice3 = new Voice(SAMPLERATE);
-    Voice* voice4 = new Voice(SAMPLERATE);
-    Voice* voice5 = new Voice(SAMPLERATE);
-    Voice* voice6 = new Voice(SAMPLERATE);
-    Voice* voice7 = new Voice(SAMPLERATE);
-    Voice* voice8 = new Voice(SAMPLERATE);
-    Voice* voices[] = {voice1, voice2, voice3, voice4, voice5, voice6, voice7, voice8};
-    voiceAllocator* allocator = new voiceAllocator(voices, sizeof(voices)/sizeof(voices[0]));
-    MidiReader* reader = new MidiReader(allocator);
-
-    std::thread audio(audioThread, voices, sizeof(voices)/sizeof(voices[0]));
-    std::thread gui(guiThread, voices, sizeof(voices)/sizeof(voices[0]), allocator);
-
-    gui.join();
+    SynthOptions options;
+    if (!parseOptions(argc, argv, options)) return 1;
+    if (options.midiList) {
+        listMidiInputs();
+        return 0;
+    }
+
+    // offline, no device, no GUI
+    if (!options.batchPath.empty()) {
+        BatchSettings settings;
+        settings.sampleRate = options.sampleRate > 0 ? options.sampleRate : DEFAULT_SAMPLE_RATE;
+        settings.blockFrames = options.bufferFrames > 0 ? options.bufferFrames : DEFAULT_BUFFER_FRAMES;
+        settings.voices = options.voices;
+        settings.workers = options.workers;
+        settings.quality = options.quality;
+        return runBatch(options.batchPath, settings) == 0 ? 0 : 1;
+    }
+    if (!options.goldenDirectory.empty()) {
+        GoldenSettings settings;
+        settings.directory = options.goldenDirectory;
+        settings.update = options.goldenUpdate;
+        settings.only = options.goldenOnly;
+        return runGolden(settings) == 0 ? 0 : 1;
+    }
+
+    // GUI only, the engine is a daemon somewhere else on this machine
+    if (!options.connectName.empty()) {
+        RemoteControl remote;
+        std::string error;
+        if (!remote.connect(options.connectName, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        std::thread gui(guiThread, &remote, std::cref(options));
+        gui.join();
+        return 0;
+    }
+
+    MidiSettings midi;
+    if (!midiSettings(options, midi)) return 1;
+    if (!options.midiEnabled) midi.inputs.clear();
+    if (options.latencyTestNotes > 0) midi.virtualPort = LATENCY_TEST_PORT;
+
+    if (options.lockMemory) {
+        std::string error;
+        if (lockProcessMemory(error)) std::cout << "Process memory locked" << std::endl;
+        else std::cout << error << ", continuing without locked memory" << std::endl;
+    }
+    traceSetEnabled(!options.tracePath.empty());
+    prefaultHeap(PREFAULT_HEAP_BYTES);
+
+    // The sink is opened first, the rate and buffer size it settles on
+    // decide how everything below gets built. The benchmark, the capacity
+    // search and the stress test have no sink.
+    AudioContext context;
+    context.options = &options;
+    std::unique_ptr<AudioSink> sink;
+    unsigned int sampleRate = options.sampleRate;
+    unsigned int bufferFrames = options.bufferFrames;
+    if (options.loadSeconds > 0) options.durationSeconds = options.loadSeconds;
+    if (options.benchmarkSeconds > 0 || options.capacitySeconds > 0 || options.stressSeconds > 0) {
+        if (sampleRate == 0) sampleRate = DEFAULT_SAMPLE_RATE;
+        if (bufferFrames == 0) bufferFrames = DEFAULT_BUFFER_FRAMES;
+    }
+    else {
+        sink.reset(createAudioSink(options.sink, options.wavPath));
+        if (!sink->open(sampleRate, bufferFrames, &renderCallback, &context)) return 1;
+        std::cout << "Audio: " << sink->name() << ", " << sampleRate << " Hz, " << bufferFrames << " frame buffers"
+                  << std::endl;
+        context.framesLeft = static_cast<uint64_t>(options.durationSeconds * sampleRate);
+    }
+
+    // The voices either run at the device rate or at --internal-rate, with
+    // the mix converted to the device rate on the way out
+    unsigned int renderRate = sampleRate;
+    if (options.internalRate > 0 && static_cast<unsigned int>(options.internalRate) != sampleRate) {
+        if (Resampler::supports(options.internalRate, sampleRate)) {
+            renderRate = options.internalRate;
+            std::cout << "Rendering at " << renderRate << " Hz, resampled to " << sampleRate << " Hz" << std::endl;
+        }
+        else {
+            std::cout << "Can't resample " << options.internalRate << " Hz to " << sampleRate
+                      << " Hz, rendering at the device rate" << std::endl;
+        }
+    }
+
+    SynthConfig config;
+    config.sampleRate = sampleRate;
+    config.renderRate = renderRate;
+    config.maxFrames = bufferFrames;
+    config.voices = options.voices;
+    if (options.benchmarkSeconds > 0 && options.instances > 1) {
+        runFarmBenchmark(config, options.quality, options.instances, options.workers, options.benchmarkSeconds);
+        return 0;
+    }
+    if (options.capacitySeconds > 0) {
+        runCapacityTest(config, loadSettings(options), options.capacitySeconds);
+        return 0;
+    }
+    Synth synth(config);
+    std::cout << "Engine: " << synth.getVoiceCount() << " voices, " << synth.getMemoryBytes() / 1024 << " KiB" << std::endl;
+    SynthEngine* engine = synth.getEngine();
+    context.engine = engine;
+    engine->setProfileInterval(options.profileInterval);
+    engine->setQualityTier(options.quality);
+    // the benchmark measures full quality, don't let the governor water it down
+    engine->getGovernor().setEnabled(options.governor && options.benchmarkSeconds <= 0);
+
+    if (options.benchmarkSeconds > 0) {
+        if (options.profileInterval == 0) engine->setProfileInterval(DEFAULT_BENCHMARK_PROFILE_INTERVAL);
+        runBenchmark(engine, options.benchmarkSeconds, bufferFrames);
+        return 0;
+    }
+    if (options.stressSeconds > 0) return runStressTest(engine, options.stressSeconds, bufferFrames) ? 0 : 1;
+    std::unique_ptr<MidiFilePlayer> player;
+    if (!options.playPath.empty()) {
+        MidiFile file;
+        std::string error;
+        if (!file.load(options.playPath, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        player.reset(new MidiFilePlayer(file, engine->getRenderRate(), options.playLoop));
+        engine->setPlayer(player.get());
+        std::cout << "Playing " << options.playPath << ", " << player->getEventCount() << " events over "
+                  << player->getDurationSeconds() << " s" << (options.playLoop ? ", looped" : "") << std::endl;
+    }
+    bool latencyTest = options.latencyTestNotes > 0;
+    // the load generator is the only note and parameter source when it runs
+    MidiReader* reader = nullptr;
+    if (options.loadSeconds <= 0 && (options.midiEnabled || latencyTest)) reader = new MidiReader(engine, midi);
+
+    Recorder* recorder = new Recorder(sampleRate, AudioSink::CHANNELS);
+    context.recorder = recorder;
+    LocalControl control(engine, recorder, options.recordPath, options.recordBits);
+    if (!options.recordPath.empty() && !recorder->start(options.recordPath, options.recordBits)) return 1;
+
+    std::thread audio(audioThread, sink.get(), &context, synth.getVoices(), synth.getVoiceCount(), bufferFrames);
+    std::thread stats;
+    if (options.statsInterval > 0) stats = std::thread(statsThread, engine, reader, std::cref(options));
+    std::thread flightDumper;
+    if (!options.flightDirectory.empty()) {
+        flightDumper = std::thread(flightRecorderDumpLoop, &engine->getFlightRecorder(), options.flightDirectory,
+                                   options.flightMaxDumps, std::cref(running));
+    }
+
+    int exitCode = 0;
+    if (latencyTest) {
+        // no GUI, loop notes back through our own virtual port and report
+        runLatencyLoopback(LATENCY_TEST_PORT, options.latencyTestNotes, running);
+    }
+    else if (options.loadSeconds > 0) {
+        // no GUI, the audio thread stops everything when the time is up
+        runLoadGenerator(engine, loadSettings(options), running);
+    }
+    else if (!options.daemonName.empty()) {
+        // no GUI in this process, one can come and go with --connect
+        std::signal(SIGINT, stopRunning);
+        std::signal(SIGTERM, stopRunning);
+        ControlServer server(&control);
+        std::string error;
+        if (server.open(options.daemonName, error)) {
+            std::cout << "Engine daemon serving \"" << options.daemonName << "\", Ctrl-C to stop" << std::endl;
+            server.run(running);
+        }
+        else {
+            std::cerr << error << std::endl;
+            exitCode = 1;
+        }
+    }
+    else if (options.durationSeconds > 0) {
+        // headless soak / render, the audio thread stops everything when the time is up
+        while (running.load()) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    else {
+        std::thread gui(guiThread, &control, std::cref(options));
+        gui.join();
+    }
     running.store(false);
     audio.join();
-
-    for (Voice* voice : voices) {
-        delete voice;
+    if (stats.joinable()) stats.join();
+    if (flightDumper.joinable()) flightDumper.join();
+    recorder->stop();
+    std::cout << EngineStats::toText(engine->getStats().snapshot()) << std::endl;
+    std::cout << LatencyStats::toText(engine->getLatencyStats().snapshot()) << std::endl;
+    std::cout << PolyphonyGovernor::toText(engine->getGovernor().snapshot()) << std::endl;
+    if (reader) std::cout << "MIDI: " << reader->getDroppedEvents() << " events dropped" << std::endl;
+    if (RTCHECK_ENABLED) rtCheckReport();
+    if (traceEnabled()) {
+        if (writeChromeTrace(options.tracePath)) std::cout << "Trace written to " << options.tracePath << std::endl;
+        else std::cerr << "Could not write trace to " << options.tracePath << std::endl;
     }
+
+    delete recorder;
     delete reader;
-    delete allocator;
 
-    return 0;
+    return exitCode;
 }
 
 /*
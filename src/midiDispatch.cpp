@@ -0,0 +1,353 @@
+#include "midiDispatch.h"
+#include <algorithm>
+#include <cmath>
+
+static const int MAX_14BIT = 16383;
+static const int BEND_CENTER = 8192;
+static const uint8_t PEDAL_DOWN = 64;
+
+static_assert(PARAM_COUNT + 1 <= MidiDispatch::MAX_EVENTS, "a program change has to fit");
+
+// What each controller number does before the map is looked at
+enum ControllerRole : uint8_t {
+    ROLE_MAPPED,            // whatever MidiMap::controller says, maybe nothing
+    ROLE_DATA_COARSE,
+    ROLE_DATA_FINE,
+    ROLE_NRPN_COARSE,
+    ROLE_NRPN_FINE,
+    ROLE_RPN_COARSE,
+    ROLE_RPN_FINE,
+    ROLE_ALL_SOUND_OFF,
+    ROLE_RESET_CONTROLLERS,
+    ROLE_ALL_NOTES_OFF,
+    ROLE_BANK_COARSE,
+    ROLE_BANK_FINE,
+    ROLE_SUSTAIN
+};
+
+struct ControllerRoles {
+    uint8_t role[128];
+
+    ControllerRoles() {
+        for (int cc = 0; cc < 128; ++cc) role[cc] = ROLE_MAPPED;
+        role[0] = ROLE_BANK_COARSE;
+        role[32] = ROLE_BANK_FINE;
+        role[64] = ROLE_SUSTAIN;
+        role[6] = ROLE_DATA_COARSE;
+        role[38] = ROLE_DATA_FINE;
+        role[99] = ROLE_NRPN_COARSE;
+        role[98] = ROLE_NRPN_FINE;
+        role[101] = ROLE_RPN_COARSE;
+        role[100] = ROLE_RPN_FINE;
+        role[120] = ROLE_ALL_SOUND_OFF;
+        role[121] = ROLE_RESET_CONTROLLERS;
+        // omni off / on, mono and poly mode all imply all notes off
+        for (int cc = 123; cc < 128; ++cc) role[cc] = ROLE_ALL_NOTES_OFF;
+    }
+};
+
+static const ControllerRoles CONTROLLERS;
+
+MidiMap::MidiMap() {
+    for (int cc = 0; cc < 128; ++cc) controller[cc] = PARAM_COUNT;
+    pressure = PARAM_COUNT;
+    for (int n = 0; n < NRPN_COUNT; ++n) nrpn[n] = PARAM_COUNT;
+}
+
+static bool programBefore(const MidiProgram& program, int key) {
+    return (program.bank << 7 | program.number) < key;
+}
+
+void MidiMap::setProgram(int bank, int number, const Patch& patch) {
+    int key = bank << 7 | number;
+    auto it = std::lower_bound(programs.begin(), programs.end(), key, programBefore);
+    if (it != programs.end() && it->bank == bank && it->number == number) {
+        it->patch = patch;
+        return;
+    }
+    MidiProgram program;
+    program.bank = static_cast<uint16_t>(bank);
+    program.number = static_cast<uint8_t>(number);
+    program.patch = patch;
+    programs.insert(it, program);
+}
+
+const Patch* MidiMap::findProgram(int bank, int number) const {
+    auto it = std::lower_bound(programs.begin(), programs.end(), bank << 7 | number, programBefore);
+    if (it == programs.end() || it->bank != bank || it->number != number) return nullptr;
+    return &it->patch;
+}
+
+const MidiMap& defaultMidiMap() {
+    static const MidiMap map = [] {
+        MidiMap m;
+        m.controller[1] = PARAM_XMOD;
+        m.controller[71] = PARAM_RESONANCE;
+        m.controller[72] = PARAM_AEG_RELEASE;
+        m.controller[73] = PARAM_AEG_ATTACK;
+        m.controller[74] = PARAM_CUTOFF;
+        m.controller[75] = PARAM_AEG_DECAY;
+        m.controller[94] = PARAM_OSC2_TUNE;
+        m.pressure = PARAM_FEG_AMOUNT;
+        for (int p = 0; p < PARAM_COUNT; ++p) m.nrpn[p] = static_cast<SynthParam>(p);
+        return m;
+    }();
+    return map;
+}
+
+// value is 0..MAX_14BIT over the parameter's range
+static int parameterEvent(SynthParam param, int value, SynthEvent* out) {
+    if (param >= PARAM_COUNT) return 0;
+    const SynthParamInfo& info = synthParamInfo(param);
+    out[0] = SynthEvent();
+    out[0].type = EVENT_PARAMETER;
+    out[0].param = param;
+    out[0].value = info.min + (info.max - info.min) * (static_cast<float>(value) / MAX_14BIT);
+    return 1;
+}
+
+// 7-bit values stretched so 127 is the top of the range too
+static int widen(uint8_t value) {
+    return (value << 7) | value;
+}
+
+static int simpleEvent(SynthEventType type, SynthEvent* out) {
+    out[0] = SynthEvent();
+    out[0].type = type;
+    return 1;
+}
+
+static int bendEvent(int bend, float range, SynthEvent* out) {
+    out[0] = SynthEvent();
+    out[0].type = EVENT_PITCH_BEND;
+    out[0].value = std::exp2(static_cast<float>(bend) / BEND_CENTER * range / 12.0f);
+    return 1;
+}
+
+const MidiDispatch::MessageType MidiDispatch::MESSAGE_TYPES[8] = {
+    {&MidiDispatch::noteOff, 2},            // 0x80
+    {&MidiDispatch::noteOn, 2},             // 0x90
+    {&MidiDispatch::polyPressure, 2},       // 0xA0
+    {&MidiDispatch::controlChange, 2},      // 0xB0
+    {&MidiDispatch::programChange, 1},      // 0xC0
+    {&MidiDispatch::channelPressure, 1},    // 0xD0
+    {&MidiDispatch::pitchBend, 2},          // 0xE0
+    {nullptr, 0},                           // 0xF0, system messages
+};
+
+MidiDispatch::MidiDispatch(const MidiMap* map) : map(map) {
+    for (ChannelState& state : channels) {
+        for (uint8_t& coarse : state.coarse) coarse = 0;
+        state.selected = 0;
+        state.selectedIsRpn = false;
+        state.hasSelection = false;
+        state.dataCoarse = 0;
+        state.dataFine = 0;
+        state.bendRange = map->bendRange;
+        state.bend = 0;
+        state.bank = 0;
+        state.sustain = false;
+        for (uint8_t& bits : state.held) bits = 0;
+        clearNotePressure(state);
+        state.pressure = 0;
+    }
+}
+
+int MidiDispatch::translate(const uint8_t* message, size_t size, SynthEvent* out) {
+    if (size == 0 || message[0] < 0x80) return 0;
+    const MessageType& type = MESSAGE_TYPES[(message[0] >> 4) - 8];
+    if (!type.handler || size < 1u + type.dataBytes) return 0;
+    uint8_t data1 = message[1];
+    uint8_t data2 = type.dataBytes > 1 ? message[2] : 0;
+    if ((data1 | data2) & 0x80) return 0;
+    return (this->*type.handler)(message[0] & 0x0F, data1, data2, out);
+}
+
+static int noteOffEvent(uint8_t note, SynthEvent* out) {
+    out[0] = SynthEvent();
+    out[0].type = EVENT_NOTE_OFF;
+    out[0].note = note;
+    return 1;
+}
+
+// The key is up either way; with the pedal down the sound carries on until it lifts
+int MidiDispatch::noteOff(int channel, uint8_t note, uint8_t, SynthEvent* out) {
+    ChannelState& state = channels[channel];
+    int count = 0;
+    if (state.notePressure[note] > 0) {
+        setNotePressure(state, note, 0);
+        count = pressureEvent(channel, out);
+    }
+    if (state.sustain) {
+        state.held[note >> 3] |= 1 << (note & 7);
+        return count;
+    }
+    return count + noteOffEvent(note, out + count);
+}
+
+int MidiDispatch::noteOn(int channel, uint8_t note, uint8_t velocity, SynthEvent* out) {
+    if (velocity == 0) return noteOff(channel, note, 0, out);
+    // played again, so the pedal no longer decides when this one stops
+    channels[channel].held[note >> 3] &= ~(1 << (note & 7));
+    out[0] = SynthEvent();
+    out[0].type = EVENT_NOTE_ON;
+    out[0].note = note;
+    out[0].velocity = velocity;
+    return 1;
+}
+
+int MidiDispatch::polyPressure(int channel, uint8_t note, uint8_t pressure, SynthEvent* out) {
+    setNotePressure(channels[channel], note, pressure);
+    return pressureEvent(channel, out);
+}
+
+int MidiDispatch::channelPressure(int channel, uint8_t pressure, uint8_t, SynthEvent* out) {
+    channels[channel].pressure = pressure;
+    return parameterEvent(map->pressure, widen(pressure), out);
+}
+
+// Keeps the per-pressure key counts and their bitmap in step, so finding the
+// hardest pressed key never has to look at all 128
+void MidiDispatch::setNotePressure(ChannelState& state, uint8_t note, uint8_t pressure) {
+    uint8_t old = state.notePressure[note];
+    if (old == pressure) return;
+    if (old > 0 && --state.pressureKeys[old] == 0) state.pressureLevels[old >> 6] &= ~(1ull << (old & 63));
+    if (pressure > 0 && state.pressureKeys[pressure]++ == 0) state.pressureLevels[pressure >> 6] |= 1ull << (pressure & 63);
+    state.notePressure[note] = pressure;
+}
+
+void MidiDispatch::clearNotePressure(ChannelState& state) {
+    for (uint8_t& pressure : state.notePressure) pressure = 0;
+    for (uint8_t& keys : state.pressureKeys) keys = 0;
+    state.pressureLevels[0] = state.pressureLevels[1] = 0;
+}
+
+// Poly pressure as channel pressure: the hardest pressed key, if that changed
+int MidiDispatch::pressureEvent(int channel, SynthEvent* out) {
+    ChannelState& state = channels[channel];
+    uint8_t hardest = 0;
+    if (state.pressureLevels[1]) hardest = 127 - __builtin_clzll(state.pressureLevels[1]);
+    else if (state.pressureLevels[0]) hardest = 63 - __builtin_clzll(state.pressureLevels[0]);
+    if (hardest == state.pressure) return 0;
+    state.pressure = hardest;
+    return parameterEvent(map->pressure, widen(hardest), out);
+}
+
+int MidiDispatch::releaseHeld(int channel, SynthEvent* out) {
+    ChannelState& state = channels[channel];
+    int count = 0;
+    for (int note = 0; note < 128; ++note) {
+        if (state.held[note >> 3] & (1 << (note & 7))) count += noteOffEvent(static_cast<uint8_t>(note), out + count);
+    }
+    for (uint8_t& bits : state.held) bits = 0;
+    return count;
+}
+
+int MidiDispatch::pitchBend(int channel, uint8_t fine, uint8_t coarse, SynthEvent* out) {
+    ChannelState& state = channels[channel];
+    state.bend = ((coarse << 7) | fine) - BEND_CENTER;
+    return bendEvent(state.bend, state.bendRange, out);
+}
+
+int MidiDispatch::programChange(int channel, uint8_t program, uint8_t, SynthEvent* out) {
+    const Patch* found = map->findProgram(channels[channel].bank, program);
+    if (!found) return 0;
+    const Patch& patch = *found;
+    int count = 0;
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (!patch.set[p]) continue;
+        out[count] = SynthEvent();
+        out[count].type = EVENT_PARAMETER;
+        out[count].param = static_cast<uint8_t>(p);
+        out[count].value = patch.values[p];
+        ++count;
+    }
+    if (patch.hasQuality) {
+        out[count] = SynthEvent();
+        out[count].type = EVENT_QUALITY;
+        out[count].param = patch.quality;
+        ++count;
+    }
+    return count;
+}
+
+int MidiDispatch::controlChange(int channel, uint8_t cc, uint8_t value, SynthEvent* out) {
+    ChannelState& state = channels[channel];
+    switch (CONTROLLERS.role[cc]) {
+        case ROLE_MAPPED:
+            if (cc < 32) {
+                state.coarse[cc] = value;
+                return parameterEvent(map->controller[cc], widen(value), out);
+            }
+            // the fine half of a 14-bit pair, if the coarse half is mapped
+            if (cc < 64 && map->controller[cc - 32] != PARAM_COUNT) {
+                return parameterEvent(map->controller[cc - 32], (state.coarse[cc - 32] << 7) | value, out);
+            }
+            return parameterEvent(map->controller[cc], widen(value), out);
+        case ROLE_DATA_COARSE:
+            state.dataCoarse = value;
+            state.dataFine = 0;
+            return dataEntry(channel, out);
+        case ROLE_DATA_FINE:
+            state.dataFine = value;
+            return dataEntry(channel, out);
+        case ROLE_NRPN_COARSE:
+        case ROLE_RPN_COARSE:
+            state.selected = static_cast<uint16_t>((value << 7) | (state.selected & 0x7F));
+            state.selectedIsRpn = CONTROLLERS.role[cc] == ROLE_RPN_COARSE;
+            state.hasSelection = !(state.selectedIsRpn && state.selected == MAX_14BIT);
+            return 0;
+        case ROLE_NRPN_FINE:
+        case ROLE_RPN_FINE:
+            state.selected = static_cast<uint16_t>((state.selected & 0x3F80) | value);
+            state.selectedIsRpn = CONTROLLERS.role[cc] == ROLE_RPN_FINE;
+            // RPN 127/127 is "none", so stray data entry goes nowhere
+            state.hasSelection = !(state.selectedIsRpn && state.selected == MAX_14BIT);
+            return 0;
+        case ROLE_BANK_COARSE:
+            state.bank = static_cast<uint16_t>((value << 7) | (state.bank & 0x7F));
+            return 0;
+        case ROLE_BANK_FINE:
+            state.bank = static_cast<uint16_t>((state.bank & 0x3F80) | value);
+            return 0;
+        case ROLE_SUSTAIN: {
+            bool down = value >= PEDAL_DOWN;
+            bool lifted = state.sustain && !down;
+            state.sustain = down;
+            return lifted ? releaseHeld(channel, out) : 0;
+        }
+        // the engine stops every voice, nothing is left for the pedal to hold
+        case ROLE_ALL_SOUND_OFF:
+            for (uint8_t& bits : state.held) bits = 0;
+            return simpleEvent(EVENT_ALL_SOUND_OFF, out);
+        case ROLE_ALL_NOTES_OFF:
+            for (uint8_t& bits : state.held) bits = 0;
+            return simpleEvent(EVENT_ALL_NOTES_OFF, out);
+        case ROLE_RESET_CONTROLLERS: {
+            state.bend = 0;
+            state.hasSelection = false;
+            clearNotePressure(state);
+            state.pressure = 0;
+            int count = bendEvent(0, state.bendRange, out);
+            count += parameterEvent(map->pressure, 0, out + count);
+            // the pedal counts as a controller and goes up too
+            if (state.sustain) count += releaseHeld(channel, out + count);
+            state.sustain = false;
+            return count;
+        }
+        default:
+            return 0;
+    }
+}
+
+int MidiDispatch::dataEntry(int channel, SynthEvent* out) {
+    ChannelState& state = channels[channel];
+    if (!state.hasSelection) return 0;
+    if (state.selectedIsRpn) {
+        // RPN 0 is the bend range in semitones and cents, the others (tuning) aren't used
+        if (state.selected != 0) return 0;
+        state.bendRange = state.dataCoarse + state.dataFine / 100.0f;
+        return bendEvent(state.bend, state.bendRange, out);
+    }
+    return parameterEvent(map->nrpn[state.selected], (state.dataCoarse << 7) | state.dataFine, out);
+}
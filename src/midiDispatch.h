@@ -0,0 +1,121 @@
+#ifndef MIDIDISPATCH_H
+#define MIDIDISPATCH_H
+
+#include "patch.h"
+#include "synthEvent.h"
+#include "synthParameters.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What the controllers drive. Every entry is a SynthParam, PARAM_COUNT for
+// nothing. Controllers 1-31 are the coarse half of a 14-bit pair whose fine
+// half is controller + 32; a controller that only ever sends the coarse half
+// works too. By default (defaultMidiMap()):
+//
+//   CC 1 mod wheel     xmod            CC 71 resonance    resonance
+//   CC 72 release      aeg_release     CC 73 attack       aeg_attack
+//   CC 74 brightness   cutoff          CC 75 decay        aeg_decay
+//   CC 94 detune       osc2_tune       pressure           feg_amount
+//   NRPN n             parameter n, in synthParameters.h order, 14 bit
+//
+// Pitch bend covers bendRange semitones either way, RPN 0 changes it per
+// channel. Programs are patches, a program change queues every value the
+// patch sets; the bank is CC 0 * 128 + CC 32 as last sent on the channel.
+// CC 64 is the sustain pedal, note-offs wait while it is down. These and
+// the controllers 6/38 and 98-101 (data entry, NRPN, RPN) and 120-127
+// (channel mode) aren't looked up in the map.
+//
+// The voices have no per-note modulation, so channel and poly pressure drive
+// the same parameter: with poly pressure it follows the hardest pressed key,
+// and drops back when that key comes up.
+struct MidiProgram {
+    uint16_t bank;
+    uint8_t number;
+    Patch patch;
+};
+
+struct MidiMap {
+    static const int NRPN_COUNT = 16384;
+
+    SynthParam controller[128];
+    SynthParam pressure;
+    SynthParam nrpn[NRPN_COUNT];
+    float bendRange = 2.0f;
+    std::vector<MidiProgram> programs;      // sorted by bank and number
+
+    // Nothing mapped, no programs
+    MidiMap();
+
+    void setProgram(int bank, int number, const Patch& patch);
+    // Null when that program isn't set
+    const Patch* findProgram(int bank, int number) const;
+};
+
+const MidiMap& defaultMidiMap();
+
+// Turns channel voice messages into engine events. Every channel is listened
+// to. Keeps what MIDI carries between messages (the coarse halves of 14-bit
+// controllers, the selected NRPN / RPN, the bend range) per channel, so each
+// input needs its own. translate() never allocates; the map is only read
+// and must outlive the dispatch.
+class MidiDispatch {
+public:
+    // The most a message turns into: reset all controllers with the pedal
+    // down releases every held note and resets bend and pressure. A program
+    // change (PARAM_COUNT + 1) is less.
+    static const int MAX_EVENTS = 128 + 2;
+
+    explicit MidiDispatch(const MidiMap* map = &defaultMidiMap());
+
+    // One complete message with its status byte. Writes up to MAX_EVENTS
+    // events to out and returns how many; system messages and anything
+    // short or malformed give none. receivedNs is left at 0.
+    int translate(const uint8_t* message, size_t size, SynthEvent* out);
+
+private:
+    typedef int (MidiDispatch::*Handler)(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    struct MessageType {
+        Handler handler;
+        uint8_t dataBytes;
+    };
+    // indexed by the status byte's high nibble - 8
+    static const MessageType MESSAGE_TYPES[8];
+
+    int noteOff(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int noteOn(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int polyPressure(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int controlChange(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int programChange(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int channelPressure(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int pitchBend(int channel, uint8_t data1, uint8_t data2, SynthEvent* out);
+    int dataEntry(int channel, SynthEvent* out);
+    int releaseHeld(int channel, SynthEvent* out);
+    int pressureEvent(int channel, SynthEvent* out);
+
+    struct ChannelState {
+        uint8_t coarse[32];         // last coarse half of controllers 0-31
+        uint16_t selected;          // NRPN or RPN number data entry goes to
+        bool selectedIsRpn;
+        bool hasSelection;
+        uint8_t dataCoarse;
+        uint8_t dataFine;
+        float bendRange;
+        int bend;                   // last pitch bend, -8192..8191
+        uint16_t bank;
+        bool sustain;
+        uint8_t held[16];           // bit per note released while the pedal was down
+        uint8_t notePressure[128];  // poly pressure of the keys that are down
+        uint8_t pressureKeys[128];  // how many keys are at each pressure, 0 isn't counted
+        uint64_t pressureLevels[2]; // bit per pressure with keys at it, for the hardest in one step
+        uint8_t pressure;           // what the pressure parameter was last sent
+    };
+
+    static void setNotePressure(ChannelState& state, uint8_t note, uint8_t pressure);
+    static void clearNotePressure(ChannelState& state);
+
+    const MidiMap* map;
+    ChannelState channels[16];
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "midiFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static const uint32_t DEFAULT_TEMPO = 500000;   // 120 bpm
+
+static uint32_t readBigEndian(const uint8_t* p, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; ++i) value = (value << 8) | p[i];
+    return value;
+}
+
+// Variable length quantity, false if it runs off the end
+static bool readVariable(const uint8_t* data, size_t size, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (pos >= size) return false;
+        uint8_t byte = data[pos++];
+        value = (value << 7) | (byte & 0x7F);
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Data bytes that follow a channel status byte
+static int dataBytes(uint8_t status) {
+    uint8_t type = status & 0xF0;
+    return (type == 0xC0 || type == 0xD0) ? 1 : 2;
+}
+
+bool MidiFile::load(const std::string& path, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + n);
+    std::fclose(file);
+    if (!parse(data.data(), data.size(), error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool MidiFile::parse(const uint8_t* data, size_t size, std::string& error) {
+    events.clear();
+    if (size < 14 || std::memcmp(data, "MThd", 4) != 0) {
+        error = "not a MIDI file";
+        return false;
+    }
+    uint32_t headerLength = readBigEndian(data + 4, 4);
+    if (headerLength < 6 || 8 + headerLength > size) {
+        error = "bad header";
+        return false;
+    }
+    uint16_t format = readBigEndian(data + 8, 2);
+    uint16_t tracks = readBigEndian(data + 10, 2);
+    division = readBigEndian(data + 12, 2);
+    if (format > 1) {
+        error = "type " + std::to_string(format) + " files aren't supported";
+        return false;
+    }
+    if (division == 0 || ((division & 0x8000) && (division & 0xFF) == 0)) {
+        error = "bad time division";
+        return false;
+    }
+
+    std::vector<TickEvent> ticks;
+    size_t pos = 8 + headerLength;
+    for (uint16_t t = 0; t < tracks && pos + 8 <= size; ++t) {
+        uint32_t length = readBigEndian(data + pos + 4, 4);
+        bool isTrack = std::memcmp(data + pos, "MTrk", 4) == 0;
+        pos += 8;
+        if (length > size - pos) {
+            error = "track " + std::to_string(t) + " is cut short";
+            return false;
+        }
+        // chunks we don't know are skipped, as the spec asks
+        if (isTrack && !parseTrack(data + pos, length, ticks, error)) return false;
+        pos += length;
+    }
+
+    std::stable_sort(ticks.begin(), ticks.end(), [](const TickEvent& a, const TickEvent& b) {
+        return a.tick != b.tick ? a.tick < b.tick : a.order < b.order;
+    });
+    applyTempoMap(ticks);
+    return true;
+}
+
+bool MidiFile::parseTrack(const uint8_t* data, size_t size, std::vector<TickEvent>& out, std::string& error) {
+    size_t pos = 0;
+    uint64_t tick = 0;
+    uint8_t runningStatus = 0;
+    while (pos < size) {
+        uint32_t delta;
+        if (!readVariable(data, size, pos, delta) || pos >= size) {
+            error = "truncated event";
+            return false;
+        }
+        tick += delta;
+        uint8_t status = data[pos];
+
+        if (status == 0xFF) {
+            if (pos + 2 > size) break;
+            uint8_t type = data[pos + 1];
+            pos += 2;
+            uint32_t length;
+            if (!readVariable(data, size, pos, length) || length > size - pos) {
+                error = "truncated meta event";
+                return false;
+            }
+            if (type == 0x51 && length == 3) {
+                TickEvent event = {tick, static_cast<uint32_t>(out.size()), 0xFF, 0, 0, readBigEndian(data + pos, 3)};
+                out.push_back(event);
+            }
+            pos += length;
+            if (type == 0x2F) break;    // end of track
+            continue;
+        }
+        if (status == 0xF0 || status == 0xF7) {
+            ++pos;
+            uint32_t length;
+            if (!readVariable(data, size, pos, length) || length > size - pos) {
+                error = "truncated sysex";
+                return false;
+            }
+            pos += length;
+            continue;
+        }
+
+        if (status & 0x80) {
+            runningStatus = status;
+            ++pos;
+        }
+        else if (runningStatus == 0) {
+            error = "data byte without a status";
+            return false;
+        }
+        int n = dataBytes(runningStatus);
+        if (pos + n > size) {
+            error = "truncated channel message";
+            return false;
+        }
+        TickEvent event = {tick, static_cast<uint32_t>(out.size()), runningStatus, data[pos],
+                           static_cast<uint8_t>(n == 2 ? data[pos + 1] : 0), 0};
+        out.push_back(event);
+        pos += n;
+    }
+    return true;
+}
+
+void MidiFile::applyTempoMap(std::vector<TickEvent>& ticks) {
+    // SMPTE division: frames per second in the (negative) high byte, ticks per frame in the low
+    double smpteTickSeconds = 0.0;
+    if (division & 0x8000) {
+        int fps = -static_cast<int8_t>(division >> 8);
+        int ticksPerFrame = division & 0xFF;
+        if (fps == 29) smpteTickSeconds = 1.0 / (29.97 * ticksPerFrame);
+        else smpteTickSeconds = 1.0 / (static_cast<double>(fps) * ticksPerFrame);
+    }
+
+    double seconds = 0.0;
+    uint64_t lastTick = 0;
+    uint32_t tempo = DEFAULT_TEMPO;
+    events.reserve(ticks.size());
+    for (const TickEvent& t : ticks) {
+        double tickSeconds = smpteTickSeconds > 0.0 ? smpteTickSeconds : tempo * 1.0e-6 / division;
+        seconds += (t.tick - lastTick) * tickSeconds;
+        lastTick = t.tick;
+        if (t.status == 0xFF) {
+            if (t.tempo > 0) tempo = t.tempo;
+            continue;
+        }
+        MidiFileEvent event = {seconds, t.status, t.data1, t.data2};
+        events.push_back(event);
+    }
+}
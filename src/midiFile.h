@@ -0,0 +1,44 @@
+#ifndef MIDIFILE_H
+#define MIDIFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One channel message from a Standard MIDI File, on an absolute clock
+struct MidiFileEvent {
+    double seconds;
+    uint8_t status;     // with the channel
+    uint8_t data1;
+    uint8_t data2;
+};
+
+// Reads a type 0 or 1 Standard MIDI File and flattens every track into one
+// list of channel messages, sorted by time, with the tempo map applied.
+// Meta events and sysex are dropped once their tempo changes are taken in.
+class MidiFile {
+public:
+    bool load(const std::string& path, std::string& error);
+    bool parse(const uint8_t* data, size_t size, std::string& error);
+
+    const std::vector<MidiFileEvent>& getEvents() const { return events; }
+    double getDurationSeconds() const { return events.empty() ? 0.0 : events.back().seconds; }
+
+private:
+    struct TickEvent {
+        uint64_t tick;
+        uint32_t order;     // file order, keeps simultaneous events stable
+        uint8_t status;
+        uint8_t data1;
+        uint8_t data2;
+        uint32_t tempo;     // microseconds per quarter note, for tempo meta events (status 0xFF)
+    };
+
+    bool parseTrack(const uint8_t* data, size_t size, std::vector<TickEvent>& out, std::string& error);
+    void applyTempoMap(std::vector<TickEvent>& ticks);
+
+    uint16_t division = 0;
+    std::vector<MidiFileEvent> events;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "midiFilePlayer.h"
+#include <cmath>
+#include <limits>
+
+int translateMidiFileEvent(MidiDispatch& dispatch, const MidiFileEvent& e, SynthEvent* out) {
+    uint8_t message[3] = {e.status, e.data1, e.data2};
+    return dispatch.translate(message, sizeof(message), out);
+}
+
+MidiFilePlayer::MidiFilePlayer(const MidiFile& file, double rate, bool loop, const MidiMap& map)
+    : rate(rate), loop(loop) {
+    MidiDispatch dispatch(&map);
+    SynthEvent translated[MidiDispatch::MAX_EVENTS];
+    events.reserve(file.getEvents().size());
+    for (const MidiFileEvent& e : file.getEvents()) {
+        int count = translateMidiFileEvent(dispatch, e, translated);
+        uint64_t frame = static_cast<uint64_t>(std::llround(e.seconds * rate));
+        for (int i = 0; i < count; ++i) {
+            const SynthEvent& event = translated[i];
+            events.push_back({frame, event.type, event.note, event.velocity, event.param, event.value});
+        }
+    }
+    // a loop lasts until just after its last event, so that one isn't doubled up with the next loop's first
+    lengthFrames = events.empty() ? 0 : events.back().frame + 1;
+    if (events.empty()) finished.store(true);
+}
+
+bool MidiFilePlayer::nextDue(SynthEvent& event) {
+    if (next == events.size()) {
+        if (!loop || lengthFrames == 0 || position < lengthFrames) return false;
+        position -= lengthFrames;
+        next = 0;
+        loops.fetch_add(1, std::memory_order_relaxed);
+    }
+    const Event& e = events[next];
+    if (e.frame > position) return false;
+    event = SynthEvent();
+    event.type = e.type;
+    event.note = e.note;
+    event.velocity = e.velocity;
+    event.param = e.param;
+    event.value = e.value;
+    if (++next == events.size() && !loop) finished.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t MidiFilePlayer::framesToNext() const {
+    if (next < events.size()) return events[next].frame > position ? events[next].frame - position : 0;
+    if (loop && lengthFrames > 0) return lengthFrames > position ? lengthFrames - position : 0;
+    return std::numeric_limits<uint64_t>::max();
+}
+
+void MidiFilePlayer::advance(unsigned int frames) {
+    position += frames;
+}
@@ -0,0 +1,60 @@
+#ifndef MIDIFILEPLAYER_H
+#define MIDIFILEPLAYER_H
+
+#include "midiDispatch.h"
+#include "midiFile.h"
+#include "synthEvent.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Feeds one file message through a dispatch, the way the batch renderer and
+// the player both turn a file into engine events, so a file sounds the same
+// offline and live
+int translateMidiFileEvent(MidiDispatch& dispatch, const MidiFileEvent& e, SynthEvent* out);
+
+// A MIDI file played by the engine itself, on the audio clock. Everything is
+// worked out when it is built: the tempo map (already applied by MidiFile)
+// and the conversion to engine events through a MidiDispatch with `map`,
+// each stamped with the frame it falls on. Playing it is a walk down an array, no parsing or allocation on the
+// audio thread. Hand it to SynthEngine::setPlayer().
+class MidiFilePlayer {
+public:
+    // rate is the voices' rate, SynthEngine::getRenderRate(). With loop the
+    // file starts over from the top when it ends.
+    MidiFilePlayer(const MidiFile& file, double rate, bool loop = false, const MidiMap& map = defaultMidiMap());
+
+    // Audio thread only
+    // Takes the next event due at the current frame, false when there are none left
+    bool nextDue(SynthEvent& event);
+    // Frames until the next event is due, UINT64_MAX when the file is over
+    uint64_t framesToNext() const;
+    void advance(unsigned int frames);
+
+    // Any thread
+    bool isFinished() const { return finished.load(std::memory_order_relaxed); }
+    uint64_t getLoops() const { return loops.load(std::memory_order_relaxed); }
+    size_t getEventCount() const { return events.size(); }
+    double getDurationSeconds() const { return lengthFrames / rate; }
+
+private:
+    struct Event {
+        uint64_t frame;
+        uint8_t type;
+        uint8_t note;
+        uint8_t velocity;
+        uint8_t param;
+        float value;
+    };
+
+    std::vector<Event> events;
+    double rate;
+    bool loop;
+    uint64_t lengthFrames = 0;
+    uint64_t position = 0;
+    size_t next = 0;
+    std::atomic<bool> finished{false};
+    std::atomic<uint64_t> loops{0};
+};
+
+#endif
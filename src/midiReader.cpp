@@ -1,125 +1,274 @@
 #include "midiReader.h"
+#include "trace.h"
+#include "rtCheck.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
 
-static std::queue<std::pair<int, int>> messagebuffer;
+// A sleep rather than a wakeup from the callbacks, so they never touch a
+// lock; an event waits up to this long in its input's queue
+static const int MERGE_TICK_US = 500;
 
-float midiNoteToHz(int midiNote) {
-    /* fm =  2^((m−69)/12) * (440 Hz)
-        where m is the MIDI note number
-    */
-   return pow(2, ((float) midiNote-69) / 12.0f) * 440;
+// Runs on RtMidi's thread for the port as each message comes in. The audio
+// thread picks the events up at the start of its next block.
+void MidiReader::callback(double deltatime, std::vector<unsigned char>* bytes, void* userdata) {
+    if (traceEnabled()) traceRegisterThread("midi");
+    RtCheckScope realtime;
+    TraceSpan span("midi callback");
+    uint64_t receivedNs = steadyNowNs();
+    auto input = (Input*) userdata;
+    SynthEvent events[MidiDispatch::MAX_EVENTS];
+    int count = input->dispatch.translate(bytes->data(), bytes->size(), events);
+    for (int i = 0; i < count; ++i) {
+        events[i].receivedNs = receivedNs;
+        bool queued = input->queue ? input->queue->write(&events[i], 1) : input->engine->pushEvent(events[i]);
+        if (!queued) input->dropped->fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
-static void midiCallback(double deltatime, std::vector<unsigned char>* bytes, void* userdata) {
-    auto allocator = (voiceAllocator*) userdata;
-    // Called when a message is received
-    if (bytes->size() < 2) return;
-    if (bytes->at(0) > 239) return;    // Message type 240 and up are system messages
-                                       // we don't want them
-
-                                       // By the MIDI standard, most messages are three bytes.
-                                       // Byte 1 denotes message type and MIDI channel
-                                       // so we get them by bitmasking
-    long type = bytes->at(0) & 0xF0;   // 0xF0 = 0b11110000
-    int channel = bytes->at(0) & 0x0F; // 0x0F = 0b00001111
-    if (type != __SK_NoteOn_ && type != __SK_NoteOff_) return; // discard messages other than noteOn and noteOff
-
-    channel += 1;
-
-    // Bytes 2 and 3 are data bytes.
-    long databyte1 = bytes->at(1);  // databyte 1 is note number
-    long databyte2 = bytes->at(2);  // databyte 2 is velocity
-    if (databyte2 == 0) type = __SK_NoteOff_;
-    if (type == __SK_NoteOn_) allocator->noteOn(midiNoteToHz(databyte1));
-    if (type == __SK_NoteOff_) allocator->noteOff(midiNoteToHz(databyte1));
-    // {1, notenumber} for note on
-    // {0, notenumber} for note off
-
-    // long databyte2 = 0;
-    // if ((type != 0xC0) && (type != 0xD0)) { // 0xC0 is Program Change, 0xD0 is aftertouch
-    //                                         // they only have one data byte
-    //     if (bytes->size() < 3) return;
-    //     databyte2 = bytes->at(2);
-    // }
-
-    // std::string typeName;
-    // switch(type){
-    //     case __SK_NoteOn_:
-    //         std::cout << "note on" << std::endl;
-    //         typeName = "Note on\t";
-    //     case __SK_NoteOff_:
-    //         std::cout << "note off" << std::endl;
-    //         typeName = "Note off\t";
-
-    //     case __SK_ControlChange_:
-    //         typeName = "ControlChange\t";
-    //         break;
-    //     default:
-    //         typeName = "Unknown\t";
-    // }
-
-    // if (type == 0xB0) { // 0xB0 = 0b10110000 = Control Change
-    //     if (typeName == "ControlChange\t") { // should always be true at this point?
-    //         messagebuffer.push({channel, {databyte1, databyte2}});
-    //     }
-    // } else {
-    //     std::cout << "unknown" << std::endl;
-    // }
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(start, end - start + 1);
+}
 
+static std::string lowercase(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
 }
 
-MidiReader::MidiReader(voiceAllocator* allocator) {
-    std::cout << "Creating MIDI input" << std::endl;
+static bool matchesPort(const std::string& pattern, unsigned int index, const std::string& portName) {
+    if (pattern == "*") return true;
+    if (!pattern.empty() && pattern.find_first_not_of("0123456789") == std::string::npos) {
+        return std::strtoul(pattern.c_str(), nullptr, 10) == index;
+    }
+    return lowercase(portName).find(lowercase(pattern)) != std::string::npos;
+}
 
+// RtMidi throws when the system has no MIDI at all (no ALSA sequencer on a
+// headless box), that just means running without MIDI
+static RtMidiIn* createMidiIn() {
     try {
-      midi_in = new RtMidiIn();
+        return new RtMidiIn();
     }
     catch (RtMidiError& e) {
         e.printMessage();
+        return nullptr;
     }
+}
 
-    midi_in->setCallback(&midiCallback, allocator);
-    midi_in->ignoreTypes(true, true, true); // ignore SysEx, timing and active sense
+bool loadMidiConfig(const std::string& path, MidiSettings& settings, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+    // patches are found next to the config file
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        line = trim(line);
+        if (line.empty()) continue;
 
-    std::cout << "Scanning available MIDI devices" << std::endl;
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected name = value";
+            return false;
+        }
+        std::string name = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+        if (value.empty()) {
+            error = path + ":" + std::to_string(lineNumber) + ": " + name + " needs a value";
+            return false;
+        }
+        // cc 74, nrpn 300, program 5: a word and a number, program 2:5 has a bank too
+        std::string word = name;
+        long number = -1;
+        long bank = 0;
+        size_t space = name.find_first_of(" \t");
+        if (space != std::string::npos) {
+            word = name.substr(0, space);
+            std::string digits = trim(name.substr(space));
+            char* end = nullptr;
+            number = std::strtol(digits.c_str(), &end, 10);
+            if (*end == ':' && word == "program") {
+                bank = number;
+                const char* rest = end + 1;
+                number = std::strtol(rest, &end, 10);
+                if (end == rest || bank < 0 || bank >= MidiMap::NRPN_COUNT) number = -1;
+            }
+            if (digits.empty() || *end != '\0') number = -1;
+        }
+        std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+        if (name == "input") settings.inputs.push_back(value);
+        else if (name == "virtual") settings.virtualPort = value;
+        else if (name == "pressure" || word == "cc" || word == "nrpn") {
+            SynthParam param = value == "none" ? PARAM_COUNT : findSynthParam(value.c_str());
+            if (param == PARAM_COUNT && value != "none") {
+                error = where + "unknown parameter \"" + value + "\"";
+                return false;
+            }
+            if (name == "pressure") settings.map.pressure = param;
+            else if (word == "cc" && number >= 0 && number < 128) settings.map.controller[number] = param;
+            else if (word == "nrpn" && number >= 0 && number < MidiMap::NRPN_COUNT) settings.map.nrpn[number] = param;
+            else {
+                error = where + "\"" + name + "\" needs a " + (word == "cc" ? "controller 0-127" : "NRPN 0-16383");
+                return false;
+            }
+        }
+        else if (name == "bend_range") {
+            char* end = nullptr;
+            float semitones = std::strtof(value.c_str(), &end);
+            if (*end != '\0' || semitones < 0 || semitones > 48) {
+                error = where + "bend_range must be 0 to 48 semitones";
+                return false;
+            }
+            settings.map.bendRange = semitones;
+        }
+        else if (word == "program") {
+            if (number < 0 || number > 127) {
+                error = where + "\"" + name + "\" needs a program 0-127, or bank:program with a bank 0-16383";
+                return false;
+            }
+            std::string patchError;
+            std::string patchPath = value[0] == '/' ? value : directory + value;
+            Patch patch;
+            if (!loadPatch(patchPath, patch, patchError)) {
+                error = where + patchError;
+                return false;
+            }
+            settings.map.setProgram(static_cast<int>(bank), static_cast<int>(number), patch);
+        }
+        else {
+            error = where + "unknown setting \"" + name + "\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+void listMidiInputs() {
+    RtMidiIn* midi_in = createMidiIn();
+    if (!midi_in) return;
     unsigned int nPorts = midi_in->getPortCount();
-    if (nPorts == 0) {
-        std::cout << "No MIDI devices available :(" << std::endl;
-        delete midi_in;
-        // what else?
+    if (nPorts == 0) std::cout << "No MIDI inputs" << std::endl;
+    for (unsigned int i = 0; i < nPorts; ++i) {
+        std::cout << i << ": " << midi_in->getPortName(i) << std::endl;
     }
-    else {
-        while(true) {
-            std::cout << "Available MIDI devices:" << std::endl;
-            for (unsigned int i = 0; i < nPorts; ++i) {
-                std::cout << i << ": " << midi_in->getPortName(i) << std::endl;
+    delete midi_in;
+}
+
+MidiReader::MidiReader(SynthEngine* engine, const MidiSettings& settings)
+    : engine(engine), map(settings.map), merging(false) {
+    // Decide on every port before opening any, each input has to know
+    // whether it feeds the engine itself or goes through the merge thread
+    std::vector<std::string> ports;
+    bool everything = settings.inputs.empty() && settings.virtualPort.empty() && settings.autoConnect;
+    if (!settings.inputs.empty() || everything) {
+        RtMidiIn* scanner = createMidiIn();
+        unsigned int nPorts = scanner ? scanner->getPortCount() : 0;
+        std::vector<bool> matched(settings.inputs.size(), false);
+        for (unsigned int i = 0; i < nPorts; ++i) {
+            std::string name = scanner->getPortName(i);
+            bool wanted = everything && lowercase(name).find("through") == std::string::npos;
+            for (size_t p = 0; p < settings.inputs.size(); ++p) {
+                if (matchesPort(settings.inputs[p], i, name)) wanted = matched[p] = true;
             }
-            std::cout << "Use which device??" << std::endl;
-            if (std::cin >> port) break;
+            if (wanted) ports.push_back(name);
+        }
+        for (size_t p = 0; p < settings.inputs.size(); ++p) {
+            if (!matched[p]) std::cout << "No MIDI input matches \"" << settings.inputs[p] << "\"" << std::endl;
         }
+        delete scanner;
     }
 
-    std::cout << "Opening device \"" << midi_in->getPortName(port) << "\"" << std::endl;
+    size_t count = ports.size() + (settings.virtualPort.empty() ? 0 : 1);
+    if (count == 0) {
+        std::cout << "No MIDI input, running without (--midi-list shows the ports)" << std::endl;
+        return;
+    }
+    bool merged = count > 1;
+    for (const std::string& name : ports) open(name, false, merged);
+    if (!settings.virtualPort.empty()) open(settings.virtualPort, true, merged);
+
+    if (merged && !inputs.empty()) {
+        std::cout << "Merging " << inputs.size() << " MIDI inputs" << std::endl;
+        merging.store(true);
+        merger = std::thread(&MidiReader::mergeLoop, this);
+    }
+}
+
+void MidiReader::open(const std::string& portName, bool isVirtual, bool merged) {
+    std::unique_ptr<Input> input(new Input(&map));
+    input->midi = createMidiIn();
+    if (!input->midi) return;
+    input->name = portName;
+    input->engine = engine;
+    input->dropped = &droppedEvents;
+    if (merged) input->queue.reset(new RingBufferT<SynthEvent>(SynthEngine::EVENT_QUEUE_SIZE));
+    input->midi->setCallback(&MidiReader::callback, input.get());
+    input->midi->ignoreTypes(true, true, true); // ignore SysEx, timing and active sense
+
     try {
-        midi_in->openPort(port);
+        if (isVirtual) {
+            std::cout << "Opening virtual MIDI port \"" << portName << "\"" << std::endl;
+            input->midi->openVirtualPort(portName);
+        }
+        else {
+            // find it again by name, the indices move when devices come and go
+            unsigned int nPorts = input->midi->getPortCount();
+            unsigned int port = 0;
+            while (port < nPorts && input->midi->getPortName(port) != portName) ++port;
+            if (port == nPorts) {
+                std::cout << "MIDI input \"" << portName << "\" went away" << std::endl;
+                delete input->midi;
+                return;
+            }
+            std::cout << "Opening MIDI input \"" << portName << "\"" << std::endl;
+            input->midi->openPort(port);
+        }
     }
     catch (RtMidiError& e) {
         e.printMessage();
+        delete input->midi;
+        return;
     }
+    inputs.push_back(std::move(input));
 }
 
-MidiReader::~MidiReader() {
-    delete midi_in;
+// Every input's events go to the engine oldest first. Each queue is already
+// in arrival order, so it is a merge on the queue heads by receive time.
+void MidiReader::mergeLoop() {
+    if (traceEnabled()) traceRegisterThread("midi merge");
+    while (merging.load()) {
+        while (true) {
+            Input* oldest = nullptr;
+            for (auto& input : inputs) {
+                if (!input->hasHead) input->hasHead = input->queue->read(&input->head, 1);
+                if (input->hasHead && (!oldest || input->head.receivedNs < oldest->head.receivedNs)) {
+                    oldest = input.get();
+                }
+            }
+            if (!oldest) break;
+            // engine queue full, the rest waits for the next tick
+            if (!engine->pushEvent(oldest->head)) break;
+            oldest->hasHead = false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(MERGE_TICK_US));
+    }
 }
 
-void MidiReader::pollMidiEvents() {
-
+MidiReader::~MidiReader() {
+    merging.store(false);
+    if (merger.joinable()) merger.join();
+    for (auto& input : inputs) delete input->midi;
 }
-
-
-
-std::pair<int, int> MidiReader::Read() {
-    if (messagebuffer.size() == 0) return {-1, -1};
-    std::pair<int, int> message = messagebuffer.front();
-    messagebuffer.pop();
-    return message;
-}
\ No newline at end of file
@@ -1,22 +1,92 @@
 #ifndef MIDIREADER_H
 #define MIDIREADER_H
 
-#include "voiceAllocator.h"
+#include "synthEngine.h"
+#include "midiDispatch.h"
 #include "stk/RtMidi.h"
-#include "stk/SKINImsg.h"
-#include <queue>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Which MIDI inputs to open. Nothing here asks anything on stdin, so the
+// program starts unattended.
+//
+// A config file has one `name = value` per line, # starts a comment. Besides
+// the ports it can change what the controllers drive (see midiDispatch.h),
+// `none` unmaps one, and set up programs from patch files next to it:
+//
+//     # the keyboard and the pad controller, plus a port for the sequencer
+//     input = Keystation
+//     input = nanoPAD
+//     virtual = new_synth
+//     cc 21 = feg_amount
+//     cc 94 = none
+//     nrpn 300 = cutoff
+//     pressure = resonance
+//     bend_range = 12
+//     program 0 = pads/warm.patch
+//     # bank 1 (CC 0 = 0, CC 32 = 1), program 0
+//     program 1:0 = pads/glass.patch
+struct MidiSettings {
+    // Every port whose name contains one of these (ignoring case) is opened,
+    // a pattern that is a plain number is a port index. "*" matches any port.
+    std::vector<std::string> inputs;
+    // A virtual input port other programs can connect to, empty = none
+    std::string virtualPort;
+    // With no inputs and no virtual port, every port except the system's
+    // MIDI Through loopback is opened
+    bool autoConnect = true;
+    MidiMap map = defaultMidiMap();
+};
+
+bool loadMidiConfig(const std::string& path, MidiSettings& settings, std::string& error);
+
+// Prints the input ports the system has, with their indices
+void listMidiInputs();
 
 class MidiReader {
 public:
-    MidiReader(voiceAllocator* allocator);
+    MidiReader(SynthEngine* engine, const MidiSettings& settings);
     ~MidiReader();
-    void pollMidiEvents();
-    std::pair<int, int> Read();
+
+    int getInputCount() const { return static_cast<int>(inputs.size()); }
+    // Events lost because the engine queue, or with several inputs the
+    // input's own queue, was full when they came in
+    uint64_t getDroppedEvents() const { return droppedEvents.load(std::memory_order_relaxed); }
 
 private:
-    float midiNoteToHz(int midiNote);
-    RtMidiIn *midi_in;
-    unsigned int port;
+    // One opened port, its callback runs on a thread of its own
+    struct Input {
+        explicit Input(const MidiMap* map) : dispatch(map) {}
+
+        RtMidiIn* midi = nullptr;
+        std::string name;
+        SynthEngine* engine = nullptr;
+        std::atomic<uint64_t>* dropped = nullptr;
+        MidiDispatch dispatch;
+        // With more than one input each callback fills its own queue and the
+        // merge thread is the engine queue's single producer. Null for a lone
+        // input, whose callback pushes straight to the engine. The merge
+        // thread polls every MERGE_TICK_US, which adds up to half a
+        // millisecond to the queue part of the note latency.
+        std::unique_ptr<RingBufferT<SynthEvent>> queue;
+        // the merge thread's next event from this input
+        SynthEvent head;
+        bool hasHead = false;
+    };
+
+    static void callback(double deltatime, std::vector<unsigned char>* bytes, void* userdata);
+    void open(const std::string& portName, bool isVirtual, bool merged);
+    void mergeLoop();
+
+    SynthEngine* engine;
+    MidiMap map;
+    std::vector<std::unique_ptr<Input>> inputs;
+    std::thread merger;
+    std::atomic<bool> merging;
+    std::atomic<uint64_t> droppedEvents{0};
 };
 
-#endif
\ No newline at end of file
+#endif
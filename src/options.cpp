@@ -0,0 +1,320 @@
+#include "options.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --rt-priority N     SCHED_FIFO priority of the audio thread, 0 disables (default 70)\n"
+              << "  --audio-cpu N       pin the audio thread to core N\n"
+              << "  --gui-cpu N         pin the GUI thread to core N\n"
+              << "  --daemon NAME       no GUI, serve the engine to --connect NAME over shared memory\n"
+              << "  --connect NAME      GUI only, control the engine daemon started with --daemon NAME\n"
+              << "  --sink KIND         rtaudio, null (paced like a device), null-fast or wav (default rtaudio)\n"
+              << "  --wav FILE          write the output to FILE, same as --sink wav\n"
+              << "  --duration S        no GUI, stop after S seconds of audio\n"
+              << "  --record FILE       record the output to FILE from the start (F4 / the record button toggle it)\n"
+              << "  --record-bits N     16 or 24 bit recordings, dithered (default 24)\n"
+              << "  --sample-rate HZ    44100 to 192000 (default: what the device prefers)\n"
+              << "  --buffer-frames N   frames per audio block, 0 = as small as the device allows (default 512)\n"
+              << "  --internal-rate HZ  render the voices at HZ and resample the mix to the device rate\n"
+              << "  --voices N          polyphony, 1 to " << MAX_VOICES << " (default 8)\n"
+              << "  --no-mlock          don't lock the process memory\n"
+              << "  --stats-interval S  print engine statistics every S seconds\n"
+              << "  --stats-json        print the statistics as JSON lines\n"
+              << "  --stats-overlay     start with the statistics overlay shown (toggle with F1)\n"
+              << "  --trace FILE        record thread spans, written to FILE on F2 and at exit\n"
+              << "  --midi-in PATTERN   open the MIDI inputs with PATTERN in their name, or input number PATTERN,\n"
+              << "                      * for all; repeatable (default: every input but MIDI Through)\n"
+              << "  --midi-virtual NAME open a virtual MIDI input called NAME for other programs to connect to\n"
+              << "  --midi-config FILE  read the MIDI ports, controller mappings and programs from FILE\n"
+              << "  --midi-list         print the MIDI inputs and exit\n"
+              << "  --no-midi           don't open any MIDI input\n"
+              << "  --play FILE         play the MIDI file FILE on the engine's own clock, live MIDI still plays along\n"
+              << "  --play-loop         with --play, start the file over when it ends\n"
+              << "  --latency-test N    no GUI, play N notes through a virtual MIDI port and report latency\n"
+              << "  --flight-dir DIR    dump the flight recorder to DIR when a block misses its deadline\n"
+              << "  --flight-dumps N    stop dumping after N dumps (default 10)\n"
+              << "  --quality TIER      eco, standard or high (default standard, F3 cycles)\n"
+              << "  --no-governor       never trade quality or polyphony for render time\n"
+              << "  --profile-every N   time the voice stages on one block in N (0 = off)\n"
+              << "  --benchmark S       no GUI or audio device, render S seconds flat out and report\n"
+              << "  --batch FILE        render the MIDI PATCH OUTPUT jobs listed in FILE in parallel and exit\n"
+              << "  --load S            no GUI or MIDI, play generated chords and knob moves for S seconds\n"
+              << "  --load-chord N      notes per generated chord (default 3)\n"
+              << "  --load-rate HZ      generated chords per second (default 2)\n"
+              << "  --load-sustain S    average time a generated note is held (default 1)\n"
+              << "  --load-spread N     semitones the generated notes spread over (default 36)\n"
+              << "  --load-knobs HZ     generated knob moves per second, 0 = none (default 10)\n"
+              << "  --capacity S        no GUI or audio device, find the highest polyphony without xruns\n"
+              << "                      for every quality tier and filter model, S seconds per step\n"
+              << "  --stress S          no GUI or audio device, render S seconds while other threads hammer the engine\n"
+              << "  --golden DIR        render the regression scenarios and compare them with the references in DIR\n"
+              << "  --golden-update     with --golden, write the references instead\n"
+              << "  --golden-only TEXT  with --golden, only the scenarios with TEXT in their name\n"
+              << "  --instances N       benchmark N independent synths rendered together (default 1)\n"
+              << "  --workers N         threads for --instances and --batch, 0 = one per core (default 0)\n"
+              << "  --help              show this message" << std::endl;
+}
+
+// Reads the argument following argv[i], advancing i
+static bool stringArgument(int argc, char* argv[], int& i, std::string& out) {
+    if (i + 1 >= argc) {
+        std::cerr << argv[i] << " needs an argument" << std::endl;
+        return false;
+    }
+    out = argv[++i];
+    return true;
+}
+
+// Reads the numeric argument following argv[i], advancing i
+static bool doubleArgument(int argc, char* argv[], int& i, double& out) {
+    if (i + 1 >= argc) {
+        std::cerr << argv[i] << " needs an argument" << std::endl;
+        return false;
+    }
+    char* end = nullptr;
+    double value = std::strtod(argv[i + 1], &end);
+    if (*end != '\0') {
+        std::cerr << argv[i] << ": \"" << argv[i + 1] << "\" is not a number" << std::endl;
+        return false;
+    }
+    out = value;
+    ++i;
+    return true;
+}
+
+// Reads the integer argument following argv[i], advancing i
+static bool intArgument(int argc, char* argv[], int& i, int& out) {
+    if (i + 1 >= argc) {
+        std::cerr << argv[i] << " needs an argument" << std::endl;
+        return false;
+    }
+    char* end = nullptr;
+    long value = std::strtol(argv[i + 1], &end, 10);
+    if (*end != '\0') {
+        std::cerr << argv[i] << ": \"" << argv[i + 1] << "\" is not a number" << std::endl;
+        return false;
+    }
+    out = static_cast<int>(value);
+    ++i;
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], SynthOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--rt-priority") == 0) {
+            if (!intArgument(argc, argv, i, options.rtPriority)) return false;
+        }
+        else if (std::strcmp(arg, "--audio-cpu") == 0) {
+            if (!intArgument(argc, argv, i, options.audioCpu)) return false;
+        }
+        else if (std::strcmp(arg, "--gui-cpu") == 0) {
+            if (!intArgument(argc, argv, i, options.guiCpu)) return false;
+        }
+        else if (std::strcmp(arg, "--daemon") == 0) {
+            if (!stringArgument(argc, argv, i, options.daemonName)) return false;
+        }
+        else if (std::strcmp(arg, "--connect") == 0) {
+            if (!stringArgument(argc, argv, i, options.connectName)) return false;
+        }
+        else if (std::strcmp(arg, "--sink") == 0) {
+            if (!stringArgument(argc, argv, i, options.sink)) return false;
+            if (options.sink != "rtaudio" && options.sink != "null" && options.sink != "null-fast" &&
+                options.sink != "wav") {
+                std::cerr << "--sink: unknown sink \"" << options.sink << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--wav") == 0) {
+            if (!stringArgument(argc, argv, i, options.wavPath)) return false;
+            options.sink = "wav";
+        }
+        else if (std::strcmp(arg, "--duration") == 0) {
+            if (!doubleArgument(argc, argv, i, options.durationSeconds)) return false;
+        }
+        else if (std::strcmp(arg, "--record") == 0) {
+            if (!stringArgument(argc, argv, i, options.recordPath)) return false;
+        }
+        else if (std::strcmp(arg, "--record-bits") == 0) {
+            if (!intArgument(argc, argv, i, options.recordBits)) return false;
+            if (options.recordBits != 16 && options.recordBits != 24) {
+                std::cerr << "--record-bits must be 16 or 24" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--sample-rate") == 0) {
+            if (!intArgument(argc, argv, i, options.sampleRate)) return false;
+            if (options.sampleRate < MIN_SAMPLE_RATE || options.sampleRate > MAX_SAMPLE_RATE) {
+                std::cerr << "--sample-rate must be between " << MIN_SAMPLE_RATE << " and " << MAX_SAMPLE_RATE << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--buffer-frames") == 0) {
+            if (!intArgument(argc, argv, i, options.bufferFrames)) return false;
+            if (options.bufferFrames < 0 || options.bufferFrames > MAX_BUFFER_FRAMES) {
+                std::cerr << "--buffer-frames must be between 0 and " << MAX_BUFFER_FRAMES << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--internal-rate") == 0) {
+            if (!intArgument(argc, argv, i, options.internalRate)) return false;
+            if (options.internalRate < MIN_SAMPLE_RATE || options.internalRate > MAX_SAMPLE_RATE) {
+                std::cerr << "--internal-rate must be between " << MIN_SAMPLE_RATE << " and " << MAX_SAMPLE_RATE << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--voices") == 0) {
+            if (!intArgument(argc, argv, i, options.voices)) return false;
+            if (options.voices < 1 || options.voices > MAX_VOICES) {
+                std::cerr << "--voices must be between 1 and " << MAX_VOICES << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--no-mlock") == 0) {
+            options.lockMemory = false;
+        }
+        else if (std::strcmp(arg, "--stats-interval") == 0) {
+            if (!doubleArgument(argc, argv, i, options.statsInterval)) return false;
+        }
+        else if (std::strcmp(arg, "--stats-json") == 0) {
+            options.statsJson = true;
+        }
+        else if (std::strcmp(arg, "--stats-overlay") == 0) {
+            options.statsOverlay = true;
+        }
+        else if (std::strcmp(arg, "--trace") == 0) {
+            if (!stringArgument(argc, argv, i, options.tracePath)) return false;
+        }
+        else if (std::strcmp(arg, "--midi-in") == 0) {
+            std::string pattern;
+            if (!stringArgument(argc, argv, i, pattern)) return false;
+            options.midiInputs.push_back(pattern);
+        }
+        else if (std::strcmp(arg, "--midi-virtual") == 0) {
+            if (!stringArgument(argc, argv, i, options.midiVirtual)) return false;
+        }
+        else if (std::strcmp(arg, "--midi-config") == 0) {
+            if (!stringArgument(argc, argv, i, options.midiConfig)) return false;
+        }
+        else if (std::strcmp(arg, "--midi-list") == 0) {
+            options.midiList = true;
+        }
+        else if (std::strcmp(arg, "--no-midi") == 0) {
+            options.midiEnabled = false;
+        }
+        else if (std::strcmp(arg, "--play") == 0) {
+            if (!stringArgument(argc, argv, i, options.playPath)) return false;
+        }
+        else if (std::strcmp(arg, "--play-loop") == 0) {
+            options.playLoop = true;
+        }
+        else if (std::strcmp(arg, "--latency-test") == 0) {
+            if (!intArgument(argc, argv, i, options.latencyTestNotes)) return false;
+        }
+        else if (std::strcmp(arg, "--flight-dir") == 0) {
+            if (!stringArgument(argc, argv, i, options.flightDirectory)) return false;
+        }
+        else if (std::strcmp(arg, "--flight-dumps") == 0) {
+            if (!intArgument(argc, argv, i, options.flightMaxDumps)) return false;
+        }
+        else if (std::strcmp(arg, "--quality") == 0) {
+            std::string name;
+            if (!stringArgument(argc, argv, i, name)) return false;
+            if (!parseQualityTier(name, options.quality)) {
+                std::cerr << "--quality: unknown tier \"" << name << "\"" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--no-governor") == 0) {
+            options.governor = false;
+        }
+        else if (std::strcmp(arg, "--profile-every") == 0) {
+            if (!intArgument(argc, argv, i, options.profileInterval)) return false;
+        }
+        else if (std::strcmp(arg, "--benchmark") == 0) {
+            if (!doubleArgument(argc, argv, i, options.benchmarkSeconds)) return false;
+        }
+        else if (std::strcmp(arg, "--batch") == 0) {
+            if (!stringArgument(argc, argv, i, options.batchPath)) return false;
+        }
+        else if (std::strcmp(arg, "--load") == 0) {
+            if (!doubleArgument(argc, argv, i, options.loadSeconds)) return false;
+        }
+        else if (std::strcmp(arg, "--load-chord") == 0) {
+            if (!intArgument(argc, argv, i, options.loadChord)) return false;
+            if (options.loadChord < 1) {
+                std::cerr << "--load-chord must be at least 1" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--load-rate") == 0) {
+            if (!doubleArgument(argc, argv, i, options.loadRate)) return false;
+        }
+        else if (std::strcmp(arg, "--load-sustain") == 0) {
+            if (!doubleArgument(argc, argv, i, options.loadSustain)) return false;
+            if (options.loadSustain <= 0) {
+                std::cerr << "--load-sustain must be above 0" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--load-spread") == 0) {
+            if (!intArgument(argc, argv, i, options.loadSpread)) return false;
+        }
+        else if (std::strcmp(arg, "--load-knobs") == 0) {
+            if (!doubleArgument(argc, argv, i, options.loadKnobs)) return false;
+        }
+        else if (std::strcmp(arg, "--capacity") == 0) {
+            if (!doubleArgument(argc, argv, i, options.capacitySeconds)) return false;
+        }
+        else if (std::strcmp(arg, "--stress") == 0) {
+            if (!doubleArgument(argc, argv, i, options.stressSeconds)) return false;
+        }
+        else if (std::strcmp(arg, "--golden") == 0) {
+            if (!stringArgument(argc, argv, i, options.goldenDirectory)) return false;
+        }
+        else if (std::strcmp(arg, "--golden-update") == 0) {
+            options.goldenUpdate = true;
+        }
+        else if (std::strcmp(arg, "--golden-only") == 0) {
+            if (!stringArgument(argc, argv, i, options.goldenOnly)) return false;
+        }
+        else if (std::strcmp(arg, "--instances") == 0) {
+            if (!intArgument(argc, argv, i, options.instances)) return false;
+            if (options.instances < 1) {
+                std::cerr << "--instances must be at least 1" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--workers") == 0) {
+            if (!intArgument(argc, argv, i, options.workers)) return false;
+        }
+        else if (std::strcmp(arg, "--help") == 0) {
+            printUsage(argv[0]);
+            return false;
+        }
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (!options.daemonName.empty() && !options.connectName.empty()) {
+        std::cerr << "--daemon and --connect are the two ends, pick one" << std::endl;
+        return false;
+    }
+    if ((options.goldenUpdate || !options.goldenOnly.empty()) && options.goldenDirectory.empty()) {
+        std::cerr << "--golden-update and --golden-only go with --golden DIR" << std::endl;
+        return false;
+    }
+    if (options.playLoop && options.playPath.empty()) {
+        std::cerr << "--play-loop goes with --play FILE" << std::endl;
+        return false;
+    }
+    if (options.sink == "wav" && options.wavPath.empty()) {
+        std::cerr << "--sink wav needs --wav FILE" << std::endl;
+        return false;
+    }
+    return true;
+}
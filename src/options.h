@@ -0,0 +1,120 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "quality.h"
+#include <string>
+#include <vector>
+
+const int MIN_SAMPLE_RATE = 44100;
+const int MAX_SAMPLE_RATE = 192000;
+const int MAX_BUFFER_FRAMES = 8192;
+// the flight recorder keeps this many voices per block
+const int MAX_VOICES = 64;
+// used when neither the command line nor the device says otherwise
+const unsigned int DEFAULT_SAMPLE_RATE = 48000;
+const unsigned int DEFAULT_BUFFER_FRAMES = 512;
+
+struct SynthOptions {
+    // Real-time setup. A priority of 0 leaves the audio thread SCHED_OTHER,
+    // a cpu of -1 leaves the thread's affinity alone.
+    int rtPriority = 70;
+    int audioCpu = -1;
+    int guiCpu = -1;
+    bool lockMemory = true;
+
+    // Audio output: rtaudio, null, null-fast or wav (to wavPath)
+    std::string sink = "rtaudio";
+    std::string wavPath;
+    // Stop after this many seconds of audio, without a GUI. 0 = run until quit.
+    double durationSeconds = 0.0;
+
+    // Record the output from the start, and the bit depth of every recording (16 or 24)
+    std::string recordPath;
+    int recordBits = 24;
+
+    // Audio format. A rate of 0 takes the device's preferred rate, 0 buffer
+    // frames the smallest buffer the device can do.
+    int sampleRate = 0;
+    int bufferFrames = 512;
+    // Polyphony
+    int voices = 8;
+    // Voices render at this rate and the mix is resampled to the device rate, 0 = off
+    int internalRate = 0;
+
+    // Engine statistics. An interval of 0 disables the periodic dump.
+    double statsInterval = 0.0;
+    bool statsJson = false;
+    bool statsOverlay = false;
+
+    // Chrome trace output, empty when tracing is off
+    std::string tracePath;
+
+    // MIDI inputs, see midiReader.h. Ports matching any of midiInputs (or
+    // the config file's inputs) are opened, plus a virtual port if named.
+    // With none of that given every input port is opened.
+    std::string midiConfig;
+    std::vector<std::string> midiInputs;
+    std::string midiVirtual;
+    bool midiEnabled = true;
+    // Print the MIDI input ports and exit
+    bool midiList = false;
+
+    // Play this MIDI file on the engine from the start, see midiFilePlayer.h
+    std::string playPath;
+    bool playLoop = false;
+
+    // Headless note latency loopback through a virtual MIDI port, 0 = off
+    int latencyTestNotes = 0;
+
+    // Where the flight recorder dumps go when a block misses its deadline, empty = no dumps
+    std::string flightDirectory;
+    int flightMaxDumps = 10;
+
+    // Run the engine without a GUI, serving one over shared memory under this name,
+    // or be that GUI and connect to the daemon with this name. Empty = neither.
+    std::string daemonName;
+    std::string connectName;
+
+    // Oscillator / filter quality bundle, can be changed at runtime with F3
+    QualityTier quality = QUALITY_STANDARD;
+
+    // Back off voice quality / polyphony when blocks get close to their deadline
+    bool governor = true;
+
+    // Per-stage voice timing on one block in every profileInterval, 0 = off
+    int profileInterval = 0;
+
+    // Render every job of this manifest in parallel and exit, see batchRender.h
+    std::string batchPath;
+
+    // Headless generated load in place of MIDI input, 0 = off. See loadGenerator.h.
+    double loadSeconds = 0.0;
+    int loadChord = 3;
+    double loadRate = 2.0;
+    double loadSustain = 1.0;
+    int loadSpread = 36;
+    double loadKnobs = 10.0;
+    // Polyphony capacity search with that load, seconds per step, 0 = off
+    double capacitySeconds = 0.0;
+
+    // Headless concurrency stress test length, see stressTest.h. 0 = off.
+    double stressSeconds = 0.0;
+
+    // Render the golden scenarios and compare them against the references in
+    // this directory, or write the references with goldenUpdate. See goldenRender.h.
+    std::string goldenDirectory;
+    bool goldenUpdate = false;
+    std::string goldenOnly;
+
+    // Headless render benchmark length, 0 = normal run
+    double benchmarkSeconds = 0.0;
+    // With the benchmark: this many independent instances rendered together
+    // on a pool of `workers` threads (0 = one per core). --batch uses the same pool size.
+    int instances = 1;
+    int workers = 0;
+};
+
+// Returns false if the program should exit (bad option or --help)
+bool parseOptions(int argc, char* argv[], SynthOptions& options);
+
+#endif
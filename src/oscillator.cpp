@@ -19,6 +19,18 @@ void Oscillator::switchWave() {
 }
 
 double Oscillator::tick() {
+    double value = tickBackend(backend);
+    if (fadeRemaining > 0) {
+        OscillatorBackend previous = backend == OSCILLATOR_BLIT ? OSCILLATOR_POLYBLEP : OSCILLATOR_BLIT;
+        double amount = static_cast<double>(fadeRemaining) / BACKEND_FADE_SAMPLES;
+        value = value * (1.0 - amount) + tickBackend(previous) * amount;
+        --fadeRemaining;
+    }
+    return value;
+}
+
+double Oscillator::tickBackend(OscillatorBackend b) {
+    if (b == OSCILLATOR_POLYBLEP) return tickPolyBlep();
     if (currentWave == SAW) {
         return saw->tick();
     } else {
@@ -26,6 +38,40 @@ double Oscillator::tick() {
     }
 }
 
+// Correction around a discontinuity, t is the phase and dt the phase increment
+static double polyBlep(double t, double dt) {
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0;
+    }
+    if (t > 1.0 - dt) {
+        t = (t - 1.0) / dt;
+        return t * t + t + t + 1.0;
+    }
+    return 0.0;
+}
+
+double Oscillator::tickPolyBlep() {
+    double value;
+    if (currentWave == SAW) {
+        value = 2.0 * phase - 1.0 - polyBlep(phase, phaseIncrement);
+    }
+    else {
+        double half = phase + 0.5;
+        if (half >= 1.0) half -= 1.0;
+        value = (phase < 0.5 ? 1.0 : -1.0) + polyBlep(phase, phaseIncrement) - polyBlep(half, phaseIncrement);
+    }
+    phase += phaseIncrement;
+    if (phase >= 1.0) phase -= 1.0;
+    return value;
+}
+
+void Oscillator::setBackend(OscillatorBackend value, bool crossfade) {
+    if (value == backend) return;
+    backend = value;
+    fadeRemaining = crossfade ? BACKEND_FADE_SAMPLES : 0;
+}
+
 void Oscillator::setBaseFrequency(float frequency) {
     baseFrequency = frequency;
     updateFrequency();
@@ -36,7 +82,14 @@ void Oscillator::setDetune(float value) {
     updateFrequency();
 }
 
+void Oscillator::setBend(float ratio) {
+    bend = ratio;
+    updateFrequency();
+}
+
 void Oscillator::updateFrequency() {
-    saw->setFrequency(baseFrequency * detune);
-    square->setFrequency(baseFrequency * detune);
+    float frequency = baseFrequency * detune * bend;
+    saw->setFrequency(frequency);
+    square->setFrequency(frequency);
+    phaseIncrement = frequency / stk::Stk::sampleRate();
 }
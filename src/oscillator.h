@@ -5,6 +5,7 @@
 
 #include "stk/BlitSaw.h"
 #include "stk/BlitSquare.h"
+#include "quality.h"
 
 enum Waveform
 {
@@ -20,15 +21,33 @@ private:
     Waveform currentWave;
     float baseFrequency;
     float detune;
+    float bend = 1.0f;
     void updateFrequency();
     float xModAmount;
+
+    OscillatorBackend backend = OSCILLATOR_BLIT;
+    // after a backend switch the old backend is faded out over this many samples
+    static const int BACKEND_FADE_SAMPLES = 64;
+    int fadeRemaining = 0;
+    double phase = 0.0;         // polyBLEP state, 0..1
+    double phaseIncrement = 0.0;
+    double tickBackend(OscillatorBackend b);
+    double tickPolyBlep();
 public:
     Oscillator();
     ~Oscillator();
     void switchWave();
+    void setWaveform(Waveform waveform) { currentWave = waveform; }
     double tick();
     void setBaseFrequency(float frequency);
     void setDetune(float value);
+    // Pitch bend as a frequency ratio, on top of the detune
+    void setBend(float ratio);
+    // Takes effect on the next tick. With crossfade the two backends are
+    // mixed for a few samples so the switch doesn't click.
+    void setBackend(OscillatorBackend value, bool crossfade);
+    OscillatorBackend getBackend() const { return backend; }
+    Waveform getWaveform() const { return currentWave; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "patch.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+Patch::Patch() {
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        values[p] = synthParamInfo(static_cast<SynthParam>(p)).defaultValue;
+        set[p] = false;
+    }
+}
+
+static std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(start, end - start + 1);
+}
+
+bool loadPatch(const std::string& path, Patch& patch, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    if (!parsePatch(text.str(), patch, error)) {
+        error = path + ":" + error;
+        return false;
+    }
+    return true;
+}
+
+bool parsePatch(const std::string& text, Patch& patch, std::string& error) {
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+    while (std::getline(lines, line)) {
+        ++number;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = std::to_string(number) + ": expected name = value";
+            return false;
+        }
+        std::string name = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        if (name == "quality") {
+            if (!parseQualityTier(value, patch.quality)) {
+                error = std::to_string(number) + ": unknown quality \"" + value + "\"";
+                return false;
+            }
+            patch.hasQuality = true;
+            continue;
+        }
+        SynthParam param = findSynthParam(name.c_str());
+        if (param == PARAM_COUNT) {
+            error = std::to_string(number) + ": unknown parameter \"" + name + "\"";
+            return false;
+        }
+        char* end = nullptr;
+        float parsed = std::strtof(value.c_str(), &end);
+        if (value.empty() || *end != '\0') {
+            error = std::to_string(number) + ": \"" + value + "\" is not a number";
+            return false;
+        }
+        const SynthParamInfo& info = synthParamInfo(param);
+        if (parsed < info.min || parsed > info.max) {
+            error = std::to_string(number) + ": " + name + " must be between " + std::to_string(info.min) + " and " +
+                    std::to_string(info.max);
+            return false;
+        }
+        patch.values[param] = parsed;
+        patch.set[param] = true;
+    }
+    return true;
+}
+
+void applyPatch(SynthEngine* engine, const Patch& patch) {
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (patch.set[p]) engine->setParameter(static_cast<SynthParam>(p), patch.values[p]);
+    }
+    if (patch.hasQuality) engine->setQualityTier(patch.quality);
+}
@@ -0,0 +1,32 @@
+#ifndef PATCH_H
+#define PATCH_H
+
+#include "synthEngine.h"
+#include "synthParameters.h"
+#include "quality.h"
+#include <string>
+
+// A saved sound, one `name = value` per line with the names from
+// synthParameters.cpp, plus `quality = eco|standard|high`. # starts a
+// comment. Anything not mentioned keeps its default.
+//
+//     # bright square lead
+//     osc1_waveform = 1
+//     cutoff = 850
+//     quality = high
+struct Patch {
+    float values[PARAM_COUNT];
+    bool set[PARAM_COUNT];
+    QualityTier quality = QUALITY_STANDARD;
+    bool hasQuality = false;
+
+    Patch();
+};
+
+bool loadPatch(const std::string& path, Patch& patch, std::string& error);
+bool parsePatch(const std::string& text, Patch& patch, std::string& error);
+
+// Queues every value the patch sets on the engine's parameter queue
+void applyPatch(SynthEngine* engine, const Patch& patch);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+// USDT (sys/sdt.h) tracepoints on the engine's hot paths, provider "new_synth".
+// Build with `make USDT=1` (needs the systemtap sdt headers) to get them; a
+// probe nobody is attached to is a single nop. Without USDT=1 they vanish.
+//
+//   sudo bpftrace -e 'usdt:./new_synth:new_synth:block_end { @load = hist(arg1 * 100 / arg2); }'
+//   sudo perf buildid-cache --add ./new_synth && sudo perf probe sdt_new_synth:xrun
+//
+// Probes and their arguments:
+//   block_start   (block, frames)
+//   block_end     (block, render ns, budget ns)
+//   note_on       (note, velocity, voice or -1 if dropped)
+//   note_off      (note)
+//   voice_steal   (voice, old Hz)        voice still sounding when retriggered
+//   param_apply   (name)                 name is a C string
+//   quality_tier  (old tier, new tier)
+//   xrun          (block, render ns, budget ns)
+//   underflow     ()                     reported by the audio device
+
+#if defined(SYNTH_USDT)
+#include <sys/sdt.h>
+#define SYNTH_PROBE(name) DTRACE_PROBE(new_synth, name)
+#define SYNTH_PROBE1(name, a) DTRACE_PROBE1(new_synth, name, a)
+#define SYNTH_PROBE2(name, a, b) DTRACE_PROBE2(new_synth, name, a, b)
+#define SYNTH_PROBE3(name, a, b, c) DTRACE_PROBE3(new_synth, name, a, b, c)
+#else
+#define SYNTH_PROBE(name) do {} while (0)
+#define SYNTH_PROBE1(name, a) do {} while (0)
+#define SYNTH_PROBE2(name, a, b) do {} while (0)
+#define SYNTH_PROBE3(name, a, b, c) do {} while (0)
+#endif
+
+#endif
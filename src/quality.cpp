@@ -0,0 +1,49 @@
+#include "quality.h"
+
+static const QualitySettings tiers[QUALITY_TIER_COUNT] = {
+    // oscillator           filter              oversampling  fast tanh  control rate
+    {OSCILLATOR_POLYBLEP,   FILTER_OBERHEIM,    1,            true,      16},   // eco
+    {OSCILLATOR_BLIT,       FILTER_OBERHEIM,    1,            false,     1},    // standard, the original sound
+    {OSCILLATOR_BLIT,       FILTER_HUOVILAINEN, 2,            false,     1},    // high, the Huovilainen ladder's own 2x
+};
+
+const char* filterModelName(FilterModel model) {
+    switch (model) {
+        case FILTER_OBERHEIM: return "oberheim";
+        case FILTER_HUOVILAINEN: return "huovilainen";
+        default: break;
+    }
+    return "unknown";
+}
+
+int filterModelOversampling(FilterModel model) {
+    return model == FILTER_HUOVILAINEN ? 2 : 1;
+}
+
+const char* oscillatorBackendName(OscillatorBackend backend) {
+    return backend == OSCILLATOR_POLYBLEP ? "polyblep" : "blit";
+}
+
+const QualitySettings& qualitySettings(QualityTier tier) {
+    return tiers[tier < QUALITY_TIER_COUNT ? tier : QUALITY_STANDARD];
+}
+
+const char* qualityTierName(QualityTier tier) {
+    switch (tier) {
+        case QUALITY_ECO: return "eco";
+        case QUALITY_STANDARD: return "standard";
+        case QUALITY_HIGH: return "high";
+        default: break;
+    }
+    return "unknown";
+}
+
+bool parseQualityTier(const std::string& name, QualityTier& tier) {
+    for (int t = 0; t < QUALITY_TIER_COUNT; ++t) {
+        if (name == qualityTierName(static_cast<QualityTier>(t))) {
+            tier = static_cast<QualityTier>(t);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,50 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <cstdint>
+#include <string>
+
+enum FilterModel : uint8_t {
+    FILTER_OBERHEIM,
+    FILTER_HUOVILAINEN,
+    FILTER_MODEL_COUNT
+};
+
+const char* filterModelName(FilterModel model);
+// How much a model oversamples inside its own Process() already, the
+// Huovilainen ladder runs twice per sample
+int filterModelOversampling(FilterModel model);
+
+enum OscillatorBackend : uint8_t {
+    OSCILLATOR_BLIT,        // STK's band-limited impulse train oscillators
+    OSCILLATOR_POLYBLEP,    // naive waveform with polyBLEP corrections, much cheaper
+};
+
+const char* oscillatorBackendName(OscillatorBackend backend);
+
+const int MAX_OVERSAMPLING = 2;
+
+// One engine-wide knob for everything that trades sound for CPU
+enum QualityTier : uint8_t {
+    QUALITY_ECO,
+    QUALITY_STANDARD,
+    QUALITY_HIGH,
+    QUALITY_TIER_COUNT
+};
+
+struct QualitySettings {
+    OscillatorBackend oscillator;
+    FilterModel filter;
+    // the ladder runs at this multiple of the sample rate, 1..MAX_OVERSAMPLING,
+    // counting the model's own oversampling; the voice does the rest
+    int oversampling;
+    bool fastSaturation;    // rational tanh approximation in the filter
+    int controlRate;        // samples between filter cutoff updates
+};
+
+const QualitySettings& qualitySettings(QualityTier tier);
+const char* qualityTierName(QualityTier tier);
+// Accepts the names qualityTierName() returns
+bool parseQualityTier(const std::string& name, QualityTier& tier);
+
+#endif
@@ -0,0 +1,153 @@
+#include "realtime.h"
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+#ifdef __OS_LINUX__
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <malloc.h>
+#endif
+
+static const size_t PAGE_GUESS = 4096;
+
+std::string RealtimeStatus::describe(const char* threadName) const {
+    std::ostringstream out;
+    out << threadName << " thread: ";
+    if (fifo) out << "SCHED_FIFO priority " << priority;
+    else out << "SCHED_OTHER";
+    if (cpu >= 0) out << ", pinned to cpu " << cpu;
+    if (!problems.empty()) out << " (" << problems << ")";
+    return out.str();
+}
+
+#ifdef __OS_LINUX__
+
+RealtimeStatus setupRealtimeThread(const char* name, int priority, int cpu) {
+    RealtimeStatus status;
+    pthread_t self = pthread_self();
+
+    // names longer than 15 characters are rejected
+    char shortName[16];
+    std::strncpy(shortName, name, sizeof(shortName) - 1);
+    shortName[sizeof(shortName) - 1] = '\0';
+    pthread_setname_np(self, shortName);
+
+    if (priority > 0) {
+        int maxPriority = sched_get_priority_max(SCHED_FIFO);
+        if (priority > maxPriority) priority = maxPriority;
+        sched_param param;
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(self, SCHED_FIFO, &param);
+        if (err == 0) {
+            status.fifo = true;
+            status.priority = priority;
+        }
+        else {
+            status.problems += std::string("SCHED_FIFO refused: ") + std::strerror(err);
+        }
+    }
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(self, sizeof(set), &set);
+        if (err == 0) {
+            status.cpu = cpu;
+        }
+        else {
+            if (!status.problems.empty()) status.problems += ", ";
+            status.problems += "pinning to cpu " + std::to_string(cpu) + " refused: " + std::strerror(err);
+        }
+    }
+
+    return status;
+}
+
+// Freed memory stays in the arena instead of being trimmed or unmapped,
+// otherwise the next allocation faults the pages in again
+static void keepFreedMemory() {
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+}
+
+bool lockProcessMemory(std::string& error) {
+    keepFreedMemory();
+
+    // MCL_ONFAULT locks pages as they are touched rather than populating every
+    // mapping up front, which matters for the huge reservations ASan makes.
+    // Memory the audio path needs is touched explicitly by the prefault calls.
+    int flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+    flags |= MCL_ONFAULT;
+#endif
+    if (mlockall(flags) != 0) {
+        error = std::string("mlockall failed: ") + std::strerror(errno) + " (check ulimit -l)";
+        return false;
+    }
+    return true;
+}
+
+static size_t pageSize() {
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<size_t>(size) : PAGE_GUESS;
+}
+
+#else
+
+RealtimeStatus setupRealtimeThread(const char* name, int priority, int cpu) {
+    RealtimeStatus status;
+    if (priority > 0 || cpu >= 0) status.problems = "real-time setup not supported on this platform";
+    return status;
+}
+
+static void keepFreedMemory() {
+}
+
+bool lockProcessMemory(std::string& error) {
+    error = "memory locking not supported on this platform";
+    return false;
+}
+
+static size_t pageSize() {
+    return PAGE_GUESS;
+}
+
+#endif
+
+void prefaultStack(size_t bytes) {
+    // volatile so the compiler can't drop the writes
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+    size_t step = pageSize();
+    for (size_t i = 0; i < bytes; i += step) stack[i] = 0;
+}
+
+void prefaultHeap(size_t bytes) {
+    // With trimming and mmap'ed chunks off the touched pages stay in the malloc
+    // arena, whether or not the memory is locked too.
+    // Plain stores to a block that is freed right away are dead, the compiler
+    // may drop them together with the malloc, so they go through volatile.
+    keepFreedMemory();
+    void* block = std::malloc(bytes);
+    if (!block) return;
+    volatile char* pages = static_cast<volatile char*>(block);
+    size_t step = pageSize();
+    for (size_t i = 0; i < bytes; i += step) pages[i] = 0;
+    std::free(block);
+}
+
+void prefaultMemory(const void* memory, size_t bytes) {
+    const volatile char* p = static_cast<const volatile char*>(memory);
+    size_t step = pageSize();
+    char sink = 0;
+    for (size_t i = 0; i < bytes; i += step) sink ^= p[i];
+    if (bytes > 0) sink ^= p[bytes - 1];
+    (void) sink;
+}
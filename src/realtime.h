@@ -0,0 +1,36 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <cstddef>
+#include <string>
+
+// What a thread actually got after asking for real-time treatment.
+// Everything here is best effort: without CAP_SYS_NICE / rtprio limits
+// the thread simply keeps running SCHED_OTHER.
+struct RealtimeStatus {
+    bool fifo = false;
+    int priority = 0;
+    int cpu = -1;
+    std::string problems;
+    std::string describe(const char* threadName) const;
+};
+
+// Call from the thread itself. Only the audio and GUI threads are set up:
+// the MIDI callbacks just translate and queue, so being preempted delays a
+// note by one scheduling slice at worst, and the WorkerPool threads only
+// render offline where nothing waits on a deadline.
+RealtimeStatus setupRealtimeThread(const char* name, int priority, int cpu);
+
+// mlockall() the current and future pages of the process and keep malloc
+// from handing memory back to the kernel, so the audio path doesn't page fault.
+// Returns false (and fills error) if the lock was refused.
+bool lockProcessMemory(std::string& error);
+
+// Touch the pages up front so the first block doesn't pay for the faults.
+// prefaultHeap() also stops malloc from giving freed memory back to the
+// kernel, with or without lockProcessMemory(), or the pages would go again.
+void prefaultStack(size_t bytes);
+void prefaultHeap(size_t bytes);
+void prefaultMemory(const void* memory, size_t bytes);
+
+#endif
@@ -0,0 +1,145 @@
+#include "recorder.h"
+#include "wavFile.h"
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static const size_t WRITER_CHUNK_FRAMES = 4096;
+static const size_t FILE_BUFFER_BYTES = 1 << 20;
+
+Recorder::Recorder(unsigned int sampleRate, unsigned int channels)
+    : sampleRate(sampleRate), channels(channels), ring(static_cast<size_t>(sampleRate) * channels * RING_SECONDS) {}
+
+Recorder::~Recorder() {
+    stop();
+}
+
+bool Recorder::start(const std::string& newPath, int bits) {
+    if (isRecording()) return false;
+    // a writer that gave up after a failed write is still to be joined and its file closed
+    stop();
+    if (bits != 16 && bits != 24) {
+        std::cerr << "Recording needs 16 or 24 bits, not " << bits << std::endl;
+        return false;
+    }
+    file = std::fopen(newPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Could not open " << newPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, FILE_BUFFER_BYTES);
+    path = newPath;
+    bitsPerSample = bits;
+    writeWavHeader(file, sampleRate, channels, bitsPerSample, false, 0);
+
+    // whatever a block that raced the last stop() left behind doesn't belong in this file
+    float discard[256];
+    while (ring.getAvailableRead() > 0) {
+        size_t n = ring.getAvailableRead() < 256 ? ring.getAvailableRead() : 256;
+        ring.read(discard, n);
+    }
+    framesWritten.store(0);
+    overruns.store(0);
+    framesDropped.store(0);
+    stopWriter.store(false);
+    writer = std::thread(&Recorder::writerLoop, this);
+    recording.store(true, std::memory_order_release);
+    std::cout << "Recording to " << path << std::endl;
+    return true;
+}
+
+void Recorder::stop() {
+    if (!writer.joinable()) return;
+    recording.store(false, std::memory_order_release);
+    stopWriter.store(true);
+    writer.join();
+    writeWavHeader(file, sampleRate, channels, bitsPerSample, false,
+                   framesWritten.load() * channels * (bitsPerSample / 8));
+    std::fclose(file);
+    file = nullptr;
+    Snapshot s = snapshot();
+    std::cout << "Recorded " << s.framesWritten << " frames to " << s.path;
+    if (s.overruns > 0) std::cout << ", " << s.overruns << " blocks (" << s.framesDropped << " frames) lost to overruns";
+    std::cout << std::endl;
+}
+
+Recorder::Snapshot Recorder::snapshot() const {
+    Snapshot s;
+    s.recording = isRecording();
+    s.framesWritten = framesWritten.load(std::memory_order_relaxed);
+    s.overruns = overruns.load(std::memory_order_relaxed);
+    s.framesDropped = framesDropped.load(std::memory_order_relaxed);
+    s.path = path;
+    return s;
+}
+
+void Recorder::capture(const float* interleaved, unsigned int nFrames) {
+    if (!recording.load(std::memory_order_acquire)) return;
+    if (!ring.write(interleaved, static_cast<size_t>(nFrames) * channels)) {
+        const std::memory_order relaxed = std::memory_order_relaxed;
+        overruns.store(overruns.load(relaxed) + 1, relaxed);
+        framesDropped.store(framesDropped.load(relaxed) + nFrames, relaxed);
+    }
+}
+
+// Polls rather than being woken, so capture() never has to signal anything.
+// After a stop it drains what is left in the ring before returning.
+void Recorder::writerLoop() {
+    std::vector<float> samples(WRITER_CHUNK_FRAMES * channels);
+    std::vector<unsigned char> bytes(samples.size() * 3);
+    const size_t bytesPerSample = bitsPerSample / 8;
+    while (true) {
+        bool stopping = stopWriter.load();
+        size_t available = ring.getAvailableRead();
+        available -= available % channels;
+        if (available == 0) {
+            if (stopping) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        size_t n = available < samples.size() ? available : samples.size();
+        ring.read(samples.data(), n);
+        convert(samples.data(), n, bytes.data());
+        if (std::fwrite(bytes.data(), bytesPerSample, n, file) != n) {
+            std::cerr << "Writing " << path << " failed, recording stopped" << std::endl;
+            recording.store(false);
+            break;
+        }
+        framesWritten.store(framesWritten.load(std::memory_order_relaxed) + n / channels, std::memory_order_relaxed);
+    }
+}
+
+// Triangular (TPDF) dither of one LSB peak, then round and clip
+void Recorder::convert(const float* in, size_t nSamples, unsigned char* out) {
+    const double scale = bitsPerSample == 16 ? 32767.0 : 8388607.0;
+    const double maxValue = scale;
+    const double minValue = -scale - 1.0;
+    for (size_t i = 0; i < nSamples; ++i) {
+        // two uniform values in [0, 1) from a xorshift, their difference is triangular in (-1, 1)
+        ditherState ^= ditherState << 13;
+        ditherState ^= ditherState >> 17;
+        ditherState ^= ditherState << 5;
+        double a = ditherState / 4294967296.0;
+        ditherState ^= ditherState << 13;
+        ditherState ^= ditherState >> 17;
+        ditherState ^= ditherState << 5;
+        double b = ditherState / 4294967296.0;
+
+        double value = std::floor(in[i] * scale + (a - b) + 0.5);
+        if (value > maxValue) value = maxValue;
+        if (value < minValue) value = minValue;
+        int32_t sample = static_cast<int32_t>(value);
+        if (bitsPerSample == 16) {
+            *out++ = sample & 0xff;
+            *out++ = (sample >> 8) & 0xff;
+        }
+        else {
+            *out++ = sample & 0xff;
+            *out++ = (sample >> 8) & 0xff;
+            *out++ = (sample >> 16) & 0xff;
+        }
+    }
+}
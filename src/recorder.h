@@ -0,0 +1,62 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "RingBuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Records the master output to a 16 or 24 bit WAV file in the background.
+//
+// The audio thread hands every block to capture(), which only copies it into
+// a lock-free ring; if the ring is full the block is dropped and counted, the
+// audio thread never waits. A writer thread drains the ring, converts to
+// integer with TPDF dither and does the (buffered) file I/O, so a stalled
+// disk costs recorded audio, never a dropout.
+class Recorder {
+public:
+    static const int RING_SECONDS = 4;
+
+    struct Snapshot {
+        bool recording;
+        uint64_t framesWritten;
+        uint64_t overruns;          // blocks dropped because the ring was full
+        uint64_t framesDropped;
+        std::string path;
+    };
+
+    // Allocates the ring, call before the audio starts
+    Recorder(unsigned int sampleRate, unsigned int channels);
+    ~Recorder();
+
+    // GUI / main thread
+    bool start(const std::string& path, int bitsPerSample);
+    void stop();
+    bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+    unsigned int getSampleRate() const { return sampleRate; }
+    Snapshot snapshot() const;
+
+    // audio thread
+    void capture(const float* interleaved, unsigned int nFrames);
+
+private:
+    void writerLoop();
+    void convert(const float* in, size_t nSamples, unsigned char* out);
+
+    unsigned int sampleRate;
+    unsigned int channels;
+    int bitsPerSample = 24;
+    RingBufferT<float> ring;
+    std::atomic<bool> recording{false};
+    std::atomic<bool> stopWriter{false};
+    std::thread writer;
+    FILE* file = nullptr;
+    std::string path;
+    uint32_t ditherState = 22222;
+    std::atomic<uint64_t> framesWritten{0};
+    std::atomic<uint64_t> overruns{0};
+    std::atomic<uint64_t> framesDropped{0};
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "resampler.h"
+#include "sharedTables.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+static const int BASE_TAPS = 32;
+static const double KAISER_BETA = 8.0;
+static const double ROLLOFF = 0.92;   // passband edge as a fraction of the lower Nyquist
+
+static int greatestCommonDivisor(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth order modified Bessel function, for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1.0e-12) break;
+    }
+    return sum;
+}
+
+// n is a multiple of 4
+static inline float dotProduct(const float* a, const float* b, int n) {
+#if defined(__SSE__)
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 4) sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    for (int i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+#endif
+}
+
+bool Resampler::supports(int inputRate, int outputRate) {
+    if (inputRate <= 0 || outputRate <= 0) return false;
+    return outputRate / greatestCommonDivisor(inputRate, outputRate) <= MAX_PHASES;
+}
+
+// Windowed sinc, phase p at p * taps, each phase stored back to front
+static std::vector<float> buildKernel(int upFactor, int downFactor, int taps) {
+    double ratio = static_cast<double>(downFactor) / upFactor;
+    // cutoff in cycles per input sample
+    double cutoff = 0.5 * ROLLOFF * (ratio > 1.0 ? 1.0 / ratio : 1.0);
+    double half = taps / 2.0;
+    std::vector<float> coefficients(static_cast<size_t>(upFactor) * taps);
+    for (int p = 0; p < upFactor; ++p) {
+        float* phaseCoefficients = &coefficients[static_cast<size_t>(p) * taps];
+        double sum = 0.0;
+        for (int k = 0; k < taps; ++k) {
+            // distance from the output instant to input sample (position - k), centred on the filter
+            double t = k + static_cast<double>(p) / upFactor - half;
+            double x = 2.0 * cutoff * t;
+            double sinc = std::fabs(x) < 1.0e-9 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            double w = t / half;
+            double window = std::fabs(w) >= 1.0 ? 0.0 : besselI0(KAISER_BETA * std::sqrt(1.0 - w * w)) / besselI0(KAISER_BETA);
+            double value = sinc * window;
+            phaseCoefficients[taps - 1 - k] = static_cast<float>(value);
+            sum += value;
+        }
+        // unity gain at DC for every phase
+        for (int k = 0; k < taps; ++k) phaseCoefficients[k] = static_cast<float>(phaseCoefficients[k] / sum);
+    }
+    return coefficients;
+}
+
+Resampler::Resampler(int inputRate, int outputRate, unsigned int maxInputFrames) : inputRate(inputRate) {
+    int divisor = greatestCommonDivisor(inputRate, outputRate);
+    upFactor = outputRate / divisor;
+    downFactor = inputRate / divisor;
+
+    // when going down the filter gets narrower, give it more taps to keep the same steepness
+    double ratio = static_cast<double>(downFactor) / upFactor;
+    taps = BASE_TAPS;
+    if (ratio > 1.0) taps = (static_cast<int>(std::ceil(BASE_TAPS * ratio)) + 3) / 4 * 4;
+
+    // the same for every engine converting between these rates
+    kernel = sharedResamplerKernel(upFactor, downFactor, taps, buildKernel);
+    coefficients = kernel->data();
+
+    // history starts out as taps - 1 zeros
+    history.assign(taps - 1 + maxInputFrames * 2, 0.0f);
+    filled = taps - 1;
+    position = taps - 1;
+}
+
+bool Resampler::write(const float* in, unsigned int nFrames) {
+    // drop whatever the next output no longer reaches back to
+    unsigned int keepFrom = position + 1 - taps;
+    if (keepFrom > 0) {
+        for (unsigned int i = keepFrom; i < filled; ++i) history[i - keepFrom] = history[i];
+        filled -= keepFrom;
+        position -= keepFrom;
+    }
+    if (filled + nFrames > history.size()) return false;
+    for (unsigned int i = 0; i < nFrames; ++i) history[filled + i] = in[i];
+    filled += nFrames;
+    return true;
+}
+
+unsigned int Resampler::read(float* out, unsigned int nFrames) {
+    unsigned int produced = 0;
+    while (produced < nFrames && position < filled) {
+        const float* phaseCoefficients = &coefficients[static_cast<size_t>(phase) * taps];
+        out[produced++] = dotProduct(phaseCoefficients, &history[position + 1 - taps], taps);
+        phase += downFactor;
+        position += phase / upFactor;
+        phase %= upFactor;
+    }
+    return produced;
+}
+
+unsigned int Resampler::inputNeeded(unsigned int nFrames) const {
+    if (nFrames == 0) return 0;
+    uint64_t steps = static_cast<uint64_t>(phase) + static_cast<uint64_t>(nFrames - 1) * downFactor;
+    uint64_t last = position + steps / upFactor;
+    return last < filled ? 0 : static_cast<unsigned int>(last + 1 - filled);
+}
+
+Oversampler2x::Oversampler2x() {
+    upKernel = sharedResamplerKernel(2, 1, UP_TAPS, buildKernel);
+    downKernel = sharedResamplerKernel(1, 2, DOWN_TAPS, buildKernel);
+    reset();
+}
+
+void Oversampler2x::reset() {
+    for (float& sample : upHistory) sample = 0.0f;
+    for (float& sample : downHistory) sample = 0.0f;
+    upPosition = 0;
+    downPosition = 0;
+}
+
+void Oversampler2x::up(float input, float out[2]) {
+    upHistory[upPosition] = upHistory[upPosition + UP_TAPS] = input;
+    upPosition = (upPosition + 1) % UP_TAPS;
+    const float* window = &upHistory[upPosition];
+    out[0] = dotProduct(upKernel->data(), window, UP_TAPS);
+    out[1] = dotProduct(upKernel->data() + UP_TAPS, window, UP_TAPS);
+}
+
+float Oversampler2x::down(const float in[2]) {
+    for (int i = 0; i < 2; ++i) {
+        downHistory[downPosition] = downHistory[downPosition + DOWN_TAPS] = in[i];
+        downPosition = (downPosition + 1) % DOWN_TAPS;
+    }
+    return dotProduct(downKernel->data(), &downHistory[downPosition], DOWN_TAPS);
+}
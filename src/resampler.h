@@ -0,0 +1,80 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <memory>
+#include <vector>
+
+// Polyphase windowed-sinc sample rate converter for the master bus.
+//
+// The rates have to reduce to a ratio L/M with at most MAX_PHASES phases
+// (every pair of the usual 44.1k / 48k families does), so every output
+// sample uses an exact precomputed phase and no interpolation. The delay is
+// half the filter length, fixed and known up front.
+//
+// write() and read() are called from the audio thread and never allocate;
+// the constructor does all of it.
+class Resampler {
+public:
+    static const int MAX_PHASES = 1024;
+
+    // Whether the ratio between the two rates is simple enough
+    static bool supports(int inputRate, int outputRate);
+
+    // maxInputFrames is the most write() will be given at a time
+    Resampler(int inputRate, int outputRate, unsigned int maxInputFrames);
+
+    // Appends input. Returns false (and takes nothing) if there is no room,
+    // read() first.
+    bool write(const float* in, unsigned int nFrames);
+    // Produces up to nFrames of output, fewer if it needs more input
+    unsigned int read(float* out, unsigned int nFrames);
+
+    // Input frames still missing for the next nFrames of output
+    unsigned int inputNeeded(unsigned int nFrames) const;
+    double latencySeconds() const { return (taps / 2.0) / inputRate; }
+    int getTaps() const { return taps; }
+    // what this instance holds on its own, the kernel is shared
+    size_t memoryBytes() const { return sizeof(*this) + history.capacity() * sizeof(float); }
+
+private:
+    int inputRate;
+    int upFactor;       // L
+    int downFactor;     // M
+    int taps;           // per phase, a multiple of 4
+    std::shared_ptr<const std::vector<float>> kernel;     // shared with every resampler at this ratio
+    const float* coefficients;          // phase p at p * taps, stored back to front
+    std::vector<float> history;
+    unsigned int filled = 0;            // valid samples in history
+    unsigned int position;              // history index of the newest input the next output needs
+    int phase = 0;
+};
+
+// 2x up and back down around something that runs per sample, the voices'
+// oversampled filters. Both halves are the Resampler's windowed-sinc kernels
+// for 1:2 and 2:1, shared the same way, so the passband reaches 0.92 of the
+// original Nyquist and the images and aliases above it are attenuated by the
+// Kaiser window rather than just averaged. The round trip delays the signal
+// by LATENCY_FRAMES. Never allocates after construction.
+class Oversampler2x {
+public:
+    static const int UP_TAPS = 32;          // per phase
+    static const int DOWN_TAPS = 64;
+    static const int LATENCY_FRAMES = UP_TAPS / 2 + DOWN_TAPS / 4;
+
+    Oversampler2x();
+
+    void up(float input, float out[2]);
+    float down(const float in[2]);
+    void reset();
+
+private:
+    std::shared_ptr<const std::vector<float>> upKernel;
+    std::shared_ptr<const std::vector<float>> downKernel;
+    // every sample written twice, TAPS apart, so the newest TAPS are always contiguous
+    float upHistory[2 * UP_TAPS];
+    float downHistory[2 * DOWN_TAPS];
+    int upPosition = 0;
+    int downPosition = 0;
+};
+
+#endif
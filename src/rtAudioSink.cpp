@@ -0,0 +1,79 @@
+#include "rtAudioSink.h"
+#include "options.h"
+#include <algorithm>
+#include <iostream>
+
+RtAudioSink::~RtAudioSink() {
+    stop();
+    if (dac.isStreamOpen()) dac.closeStream();
+}
+
+bool RtAudioSink::open(unsigned int& sampleRate, unsigned int& bufferFrames, RenderCallback callback, void* userData) {
+    this->callback = callback;
+    this->userData = userData;
+    if (dac.getDeviceCount() < 1) {
+        std::cerr << "No audio devices found" << std::endl;
+        return false;
+    }
+
+    RtAudio::StreamParameters parameters;
+    parameters.deviceId = dac.getDefaultOutputDevice();
+    parameters.nChannels = CHANNELS;
+
+    RtAudio::DeviceInfo info = dac.getDeviceInfo(parameters.deviceId);
+    unsigned int preferred = info.preferredSampleRate;
+    if (preferred < MIN_SAMPLE_RATE || preferred > MAX_SAMPLE_RATE) preferred = DEFAULT_SAMPLE_RATE;
+    if (sampleRate == 0) sampleRate = preferred;
+    if (!info.sampleRates.empty() &&
+        std::find(info.sampleRates.begin(), info.sampleRates.end(), sampleRate) == info.sampleRates.end()) {
+        std::cout << info.name << " doesn't do " << sampleRate << " Hz, using " << preferred << " Hz" << std::endl;
+        sampleRate = preferred;
+    }
+
+    // 0 frames asks for the smallest buffer the device can do
+    RtAudio::StreamOptions streamOptions;
+    if (bufferFrames == 0) streamOptions.flags |= RTAUDIO_MINIMIZE_LATENCY;
+
+    try {
+        dac.openStream(&parameters, nullptr, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &deviceCallback, this,
+                       &streamOptions);
+    }
+    catch ( RtAudioError& e ) {
+        e.printMessage();
+        return false;
+    }
+    // frames queued in the device ahead of the block being rendered
+    latency = static_cast<unsigned int>(dac.getStreamLatency());
+    return true;
+}
+
+bool RtAudioSink::start() {
+    try {
+        dac.startStream();
+    }
+    catch ( RtAudioError& e ) {
+        e.printMessage();
+        return false;
+    }
+    return true;
+}
+
+bool RtAudioSink::isRunning() const {
+    return dac.isStreamRunning();
+}
+
+void RtAudioSink::stop() {
+    try {
+        if (dac.isStreamRunning()) dac.stopStream();
+    }
+    catch ( RtAudioError& e ) {
+        e.printMessage();
+    }
+}
+
+int RtAudioSink::deviceCallback(void* outputBuffer, void* /*inputBuffer*/, unsigned int nFrames,
+                                double /*streamTime*/, RtAudioStreamStatus status, void* userData) {
+    RtAudioSink* sink = static_cast<RtAudioSink*>(userData);
+    bool underflow = (status & RTAUDIO_OUTPUT_UNDERFLOW) != 0;
+    return sink->callback(static_cast<float*>(outputBuffer), nFrames, underflow, sink->userData) ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#ifndef RTAUDIOSINK_H
+#define RTAUDIOSINK_H
+
+#include "audioSink.h"
+#include "stk/RtAudio.h"
+
+// The default output device through RtAudio. Asks for the requested rate if
+// the device lists it, else takes the device's preferred rate; the device
+// has the final say on the buffer size.
+class RtAudioSink : public AudioSink {
+public:
+    ~RtAudioSink() override;
+    const char* name() const override { return "rtaudio"; }
+
+    bool open(unsigned int& sampleRate, unsigned int& bufferFrames, RenderCallback callback, void* userData) override;
+    unsigned int latencyFrames() const override { return latency; }
+    bool start() override;
+    bool isRunning() const override;
+    void stop() override;
+
+private:
+    static int deviceCallback(void* outputBuffer, void* inputBuffer, unsigned int nFrames,
+                              double streamTime, RtAudioStreamStatus status, void* userData);
+
+    RtAudio dac;
+    RenderCallback callback = nullptr;
+    void* userData = nullptr;
+    unsigned int latency = 0;
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "rtCheck.h"
+
+#if defined(SYNTH_RTCHECK)
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <pthread.h>
+
+// glibc's own allocator entry points, what the interposers below hand on to
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+static const int MAX_REPORTS = 64;
+static const int MAX_FRAMES = 32;
+
+// One distinct stack, however many times it was hit
+struct Report {
+    const char* function;
+    int depth;
+    void* frames[MAX_FRAMES];
+    std::atomic<uint64_t> hits;
+    std::atomic<bool> ready;
+};
+
+static Report reports[MAX_REPORTS];
+static std::atomic<int> reportCount(0);
+static std::atomic<uint64_t> violations(0);
+
+// initial-exec so reading them never calls into the allocator
+static __thread int realtimeDepth __attribute__((tls_model("initial-exec"))) = 0;
+static __thread int flagging __attribute__((tls_model("initial-exec"))) = 0;
+
+typedef int (*MutexFunction)(pthread_mutex_t*);
+typedef int (*TimedMutexFunction)(pthread_mutex_t*, const struct timespec*);
+static MutexFunction realLock = nullptr;
+static MutexFunction realTrylock = nullptr;
+static TimedMutexFunction realTimedlock = nullptr;
+
+static void resolveMutexFunctions() {
+    realLock = reinterpret_cast<MutexFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+    realTrylock = reinterpret_cast<MutexFunction>(dlsym(RTLD_NEXT, "pthread_mutex_trylock"));
+    realTimedlock = reinterpret_cast<TimedMutexFunction>(dlsym(RTLD_NEXT, "pthread_mutex_timedlock"));
+}
+
+// Before main: the unwinder backtrace() needs is loaded on its first call,
+// which allocates, so get that over with here
+__attribute__((constructor(101))) static void initialize() {
+    resolveMutexFunctions();
+    void* frames[1];
+    backtrace(frames, 1);
+}
+
+static bool sameStack(const Report& report, void* const* frames, int depth) {
+    return report.depth == depth && std::memcmp(report.frames, frames, depth * sizeof(void*)) == 0;
+}
+
+static void flag(const char* function) {
+    if (realtimeDepth == 0 || flagging) return;
+    // whatever backtrace() itself calls goes straight through
+    flagging = 1;
+    violations.fetch_add(1, std::memory_order_relaxed);
+    void* frames[MAX_FRAMES];
+    int depth = backtrace(frames, MAX_FRAMES);
+    int count = reportCount.load(std::memory_order_acquire);
+    bool known = false;
+    for (int i = 0; i < count && i < MAX_REPORTS; ++i) {
+        if (reports[i].ready.load(std::memory_order_acquire) && sameStack(reports[i], frames, depth)) {
+            reports[i].hits.fetch_add(1, std::memory_order_relaxed);
+            known = true;
+            break;
+        }
+    }
+    if (!known) {
+        int slot = reportCount.fetch_add(1, std::memory_order_acq_rel);
+        if (slot < MAX_REPORTS) {
+            Report& report = reports[slot];
+            report.function = function;
+            report.depth = depth;
+            std::memcpy(report.frames, frames, depth * sizeof(void*));
+            report.hits.store(1, std::memory_order_relaxed);
+            report.ready.store(true, std::memory_order_release);
+        }
+    }
+    flagging = 0;
+}
+
+void rtCheckEnter() {
+    ++realtimeDepth;
+}
+
+void rtCheckLeave() {
+    --realtimeDepth;
+}
+
+uint64_t rtCheckViolations() {
+    return violations.load(std::memory_order_relaxed);
+}
+
+void rtCheckReport() {
+    uint64_t total = violations.load(std::memory_order_relaxed);
+    int count = reportCount.load(std::memory_order_acquire);
+    std::fprintf(stderr, "rtcheck: %llu heap / mutex calls on real-time threads from %d places\n",
+                 static_cast<unsigned long long>(total), count);
+    for (int i = 0; i < count && i < MAX_REPORTS; ++i) {
+        const Report& report = reports[i];
+        if (!report.ready.load(std::memory_order_acquire)) continue;
+        std::fprintf(stderr, "rtcheck: %s, %llu times:\n", report.function,
+                     static_cast<unsigned long long>(report.hits.load(std::memory_order_relaxed)));
+        // frame 0 is flag() and 1 the interposer
+        if (report.depth > 2) backtrace_symbols_fd(report.frames + 2, report.depth - 2, 2);
+    }
+    if (count > MAX_REPORTS) std::fprintf(stderr, "rtcheck: %d more places not kept\n", count - MAX_REPORTS);
+}
+
+extern "C" {
+
+void* malloc(size_t size) noexcept {
+    flag("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    flag("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept {
+    flag("realloc");
+    return __libc_realloc(pointer, size);
+}
+
+void free(void* pointer) noexcept {
+    if (pointer) flag("free");
+    __libc_free(pointer);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    flag("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    flag("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) noexcept {
+    flag("posix_memalign");
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    void* pointer = __libc_memalign(alignment, size);
+    if (!pointer) return ENOMEM;
+    *out = pointer;
+    return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept {
+    flag("pthread_mutex_lock");
+    if (!realLock) resolveMutexFunctions();
+    return realLock(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex) noexcept {
+    flag("pthread_mutex_trylock");
+    if (!realTrylock) resolveMutexFunctions();
+    return realTrylock(mutex);
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* timeout) noexcept {
+    flag("pthread_mutex_timedlock");
+    if (!realTimedlock) resolveMutexFunctions();
+    return realTimedlock(mutex, timeout);
+}
+
+}
+
+#endif
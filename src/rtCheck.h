@@ -0,0 +1,39 @@
+#ifndef RTCHECK_H
+#define RTCHECK_H
+
+#include <cstdint>
+
+// Catches heap and mutex calls made on threads that must never block. Build
+// with `make RTCHECK=1`: malloc, calloc, realloc, free and the aligned
+// allocators (which new and delete go through) and pthread_mutex_lock /
+// trylock / timedlock are interposed. A call from a thread inside an
+// RtCheckScope is counted and its stack trace kept in a preallocated buffer;
+// rtCheckReport() prints them. ASan is off in that build, it brings its own
+// malloc. Without RTCHECK=1 all of this compiles to nothing.
+
+#if defined(SYNTH_RTCHECK)
+const bool RTCHECK_ENABLED = true;
+void rtCheckEnter();
+void rtCheckLeave();
+// Calls flagged so far, on any thread
+uint64_t rtCheckViolations();
+// Prints the count and the stack traces kept, to stderr
+void rtCheckReport();
+#else
+const bool RTCHECK_ENABLED = false;
+inline void rtCheckEnter() {}
+inline void rtCheckLeave() {}
+inline uint64_t rtCheckViolations() { return 0; }
+inline void rtCheckReport() {}
+#endif
+
+// The current thread counts as real-time while one of these is alive. Nests.
+class RtCheckScope {
+public:
+    RtCheckScope() { rtCheckEnter(); }
+    ~RtCheckScope() { rtCheckLeave(); }
+    RtCheckScope(const RtCheckScope&) = delete;
+    RtCheckScope& operator=(const RtCheckScope&) = delete;
+};
+
+#endif
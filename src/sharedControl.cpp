@@ -0,0 +1,273 @@
+#include "sharedControl.h"
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <thread>
+
+#ifdef __OS_LINUX__
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t CONTROL_MAGIC = 0x4e53594e;    // "NSYN"
+// bump whenever the layout of SharedControlBlock changes
+static const uint32_t CONTROL_VERSION = 1;
+
+static std::string segmentName(const std::string& name) {
+    return "/new_synth-" + name;
+}
+
+#ifdef __OS_LINUX__
+
+static bool processAlive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// Maps an existing segment, nullptr if there is none or it isn't ours
+static SharedControlBlock* mapSegment(const std::string& shmName, std::string& error) {
+    int fd = shm_open(shmName.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        error = "no engine daemon at " + shmName + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedControlBlock)) {
+        close(fd);
+        error = shmName + " is not an engine daemon segment";
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, sizeof(SharedControlBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        error = std::string("mmap failed: ") + std::strerror(errno);
+        return nullptr;
+    }
+    SharedControlBlock* block = static_cast<SharedControlBlock*>(memory);
+    if (block->magic != CONTROL_MAGIC || block->version != CONTROL_VERSION) {
+        munmap(block, sizeof(SharedControlBlock));
+        error = shmName + " was made by a different version of the engine";
+        return nullptr;
+    }
+    return block;
+}
+
+ControlServer::ControlServer(SynthControl* control) : control(control) {}
+
+ControlServer::~ControlServer() {
+    if (!block) return;
+    munmap(block, sizeof(SharedControlBlock));
+    shm_unlink(shmName.c_str());
+}
+
+bool ControlServer::open(const std::string& name, std::string& error) {
+    shmName = segmentName(name);
+
+    std::string ignored;
+    SharedControlBlock* existing = mapSegment(shmName, ignored);
+    if (existing) {
+        bool alive = processAlive(existing->serverPid.load());
+        munmap(existing, sizeof(SharedControlBlock));
+        if (alive) {
+            error = "an engine daemon is already serving " + shmName;
+            return false;
+        }
+    }
+    // left behind by a daemon that didn't get to clean up
+    shm_unlink(shmName.c_str());
+
+    int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        error = "could not create " + shmName + ": " + std::strerror(errno);
+        return false;
+    }
+    // ftruncate zero fills, which is a valid state for the rings and atomics
+    if (ftruncate(fd, sizeof(SharedControlBlock)) != 0) {
+        error = std::string("could not size the segment: ") + std::strerror(errno);
+        close(fd);
+        shm_unlink(shmName.c_str());
+        return false;
+    }
+    void* memory = mmap(nullptr, sizeof(SharedControlBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        error = std::string("mmap failed: ") + std::strerror(errno);
+        shm_unlink(shmName.c_str());
+        return false;
+    }
+    block = static_cast<SharedControlBlock*>(memory);
+    block->version = CONTROL_VERSION;
+    block->serverPid.store(getpid());
+    std::atomic_thread_fence(std::memory_order_release);
+    block->magic = CONTROL_MAGIC;
+    return true;
+}
+
+void ControlServer::run(const std::atomic<bool>& running) {
+    int32_t client = 0;
+    while (running.load()) {
+        block->heartbeat.store(block->heartbeat.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+        int32_t pid = block->clientPid.load();
+        if (pid != client) {
+            if (pid != 0) std::cout << "GUI connected (pid " << pid << ")" << std::endl;
+            else std::cout << "GUI disconnected" << std::endl;
+            client = pid;
+        }
+
+        // bounded, so a runaway client can't keep us in here
+        ControlCommand command;
+        for (int n = 0; n < 256 && block->commands.read(command); ++n) applyCommand(command);
+
+        publish();
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+    }
+}
+
+// The client is another process, nothing it sends is trusted
+void ControlServer::applyCommand(const ControlCommand& command) {
+    switch (command.type) {
+        case COMMAND_SET_PARAMETER:
+            if (command.param < PARAM_COUNT && std::isfinite(command.value)) {
+                control->setParameter(static_cast<SynthParam>(command.param), command.value);
+            }
+            break;
+        case COMMAND_SET_QUALITY:
+            if (command.param < QUALITY_TIER_COUNT) control->setQualityTier(static_cast<QualityTier>(command.param));
+            break;
+        case COMMAND_TOGGLE_RECORDING:
+            control->toggleRecording();
+            break;
+        default:
+            break;
+    }
+}
+
+// Dropped if the GUI isn't keeping up, it only ever wants the latest one
+void ControlServer::publish() {
+    MeterFrame frame;
+    frame.sequence = ++sequence;
+    frame.status = control->status();
+    for (int p = 0; p < PARAM_COUNT; ++p) frame.parameters[p] = control->getParameter(static_cast<SynthParam>(p));
+    block->meters.write(frame);
+}
+
+RemoteControl::~RemoteControl() {
+    if (!block) return;
+    int32_t me = getpid();
+    block->clientPid.compare_exchange_strong(me, 0);
+    munmap(block, sizeof(SharedControlBlock));
+}
+
+bool RemoteControl::connect(const std::string& name, std::string& error) {
+    std::string shmName = segmentName(name);
+    block = mapSegment(shmName, error);
+    if (!block) return false;
+
+    int32_t daemon = block->serverPid.load();
+    if (!processAlive(daemon)) {
+        error = "the engine daemon behind " + shmName + " is gone";
+        munmap(block, sizeof(SharedControlBlock));
+        block = nullptr;
+        return false;
+    }
+    // one GUI at a time, the rings only have one end each. A GUI that died
+    // without letting go doesn't count.
+    int32_t me = getpid();
+    int32_t other = 0;
+    if (!block->clientPid.compare_exchange_strong(other, me)) {
+        if (processAlive(other) || !block->clientPid.compare_exchange_strong(other, me)) {
+            error = "another GUI (pid " + std::to_string(other) + ") is connected to " + shmName;
+            munmap(block, sizeof(SharedControlBlock));
+            block = nullptr;
+            return false;
+        }
+    }
+
+    // start the knobs where the daemon has them
+    for (int p = 0; p < PARAM_COUNT; ++p) parameters[p] = synthParamInfo(static_cast<SynthParam>(p)).defaultValue;
+    lastBeatTime = std::chrono::steady_clock::now();
+    auto deadline = lastBeatTime + std::chrono::milliseconds(TIMEOUT_MS);
+    while (latest.sequence == 0 && std::chrono::steady_clock::now() < deadline) {
+        poll();
+        if (latest.sequence == 0) std::this_thread::sleep_for(std::chrono::milliseconds(ControlServer::POLL_MS));
+    }
+    if (latest.sequence != 0) std::memcpy(parameters, latest.parameters, sizeof(parameters));
+    std::cout << "Connected to the engine daemon at " << shmName << " (pid " << daemon << ")" << std::endl;
+    return true;
+}
+
+void RemoteControl::poll() {
+    MeterFrame frame;
+    while (block->meters.read(frame)) latest = frame;
+    uint64_t beat = block->heartbeat.load(std::memory_order_acquire);
+    if (beat != lastHeartbeat) {
+        lastHeartbeat = beat;
+        lastBeatTime = std::chrono::steady_clock::now();
+    }
+}
+
+bool RemoteControl::send(const ControlCommand& command) {
+    return block->commands.write(command);
+}
+
+bool RemoteControl::setParameter(SynthParam param, float value) {
+    if (param >= PARAM_COUNT) return false;
+    parameters[param] = value;
+    ControlCommand command = {COMMAND_SET_PARAMETER, param, value};
+    return send(command);
+}
+
+void RemoteControl::setQualityTier(QualityTier tier) {
+    ControlCommand command = {COMMAND_SET_QUALITY, static_cast<uint8_t>(tier), 0.0f};
+    send(command);
+}
+
+void RemoteControl::toggleRecording() {
+    ControlCommand command = {COMMAND_TOGGLE_RECORDING, 0, 0.0f};
+    send(command);
+}
+
+SynthControl::Status RemoteControl::status() {
+    poll();
+    return latest.status;
+}
+
+bool RemoteControl::isConnected() const {
+    if (block->heartbeat.load(std::memory_order_acquire) != lastHeartbeat) return true;
+    return std::chrono::steady_clock::now() - lastBeatTime < std::chrono::milliseconds(TIMEOUT_MS);
+}
+
+#else
+
+ControlServer::ControlServer(SynthControl* control) : control(control) {}
+ControlServer::~ControlServer() {}
+
+bool ControlServer::open(const std::string& name, std::string& error) {
+    error = "the engine daemon needs POSIX shared memory";
+    return false;
+}
+
+void ControlServer::run(const std::atomic<bool>& running) {}
+void ControlServer::applyCommand(const ControlCommand& command) {}
+void ControlServer::publish() {}
+
+RemoteControl::~RemoteControl() {}
+
+bool RemoteControl::connect(const std::string& name, std::string& error) {
+    error = "connecting to an engine daemon needs POSIX shared memory";
+    return false;
+}
+
+void RemoteControl::poll() {}
+bool RemoteControl::send(const ControlCommand& command) { return false; }
+bool RemoteControl::setParameter(SynthParam param, float value) { return false; }
+void RemoteControl::setQualityTier(QualityTier tier) {}
+void RemoteControl::toggleRecording() {}
+SynthControl::Status RemoteControl::status() { return latest.status; }
+bool RemoteControl::isConnected() const { return false; }
+
+#endif
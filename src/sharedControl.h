@@ -0,0 +1,128 @@
+#ifndef SHAREDCONTROL_H
+#define SHAREDCONTROL_H
+
+#include "synthControl.h"
+#include "synthParameters.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// The engine running as its own process (--daemon NAME) with the GUI in
+// another (--connect NAME). They share one POSIX shared memory segment,
+// /new_synth-NAME, holding two lock-free rings: commands from the GUI to the
+// daemon and meter frames from the daemon to the GUI.
+//
+// The audio thread never touches the segment. A control thread in the daemon
+// polls the command ring, hands the commands to the engine's own queues and
+// publishes a meter frame every poll. If the GUI hangs, its rings just fill
+// up and frames get dropped; if it dies, the next one takes over its slot.
+
+// Single producer / single consumer ring that can live in shared memory: no
+// pointers, and all zeroes is an empty ring.
+template <typename T, uint32_t N>
+struct SharedRing {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+    std::atomic<uint32_t> writeIndex;
+    std::atomic<uint32_t> readIndex;
+    T items[N];
+
+    bool write(const T& item) {
+        uint32_t w = writeIndex.load(std::memory_order_relaxed);
+        if (w - readIndex.load(std::memory_order_acquire) >= N) return false;
+        items[w % N] = item;
+        writeIndex.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool read(T& item) {
+        uint32_t r = readIndex.load(std::memory_order_relaxed);
+        if (r == writeIndex.load(std::memory_order_acquire)) return false;
+        item = items[r % N];
+        readIndex.store(r + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+enum ControlCommandType : uint8_t {
+    COMMAND_SET_PARAMETER,
+    COMMAND_SET_QUALITY,
+    COMMAND_TOGGLE_RECORDING
+};
+
+struct ControlCommand {
+    uint8_t type;
+    uint8_t param;      // SynthParam or QualityTier
+    float value;
+};
+
+struct MeterFrame {
+    uint64_t sequence;
+    SynthControl::Status status;
+    float parameters[PARAM_COUNT];
+};
+
+struct SharedControlBlock {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<int32_t> serverPid;
+    std::atomic<int32_t> clientPid;        // 0 when no GUI is connected
+    std::atomic<uint64_t> heartbeat;       // bumped by the daemon on every poll
+    SharedRing<ControlCommand, 256> commands;
+    SharedRing<MeterFrame, 16> meters;
+};
+
+// Daemon side. Creates the segment and serves whatever connects to it.
+class ControlServer {
+public:
+    static const int POLL_MS = 10;
+
+    explicit ControlServer(SynthControl* control);
+    ~ControlServer();
+
+    // Replaces a segment left behind by a daemon that died
+    bool open(const std::string& name, std::string& error);
+    // Polls until running goes false
+    void run(const std::atomic<bool>& running);
+
+private:
+    void applyCommand(const ControlCommand& command);
+    void publish();
+
+    SynthControl* control;
+    std::string shmName;
+    SharedControlBlock* block = nullptr;
+    uint64_t sequence = 0;
+};
+
+// GUI side
+class RemoteControl : public SynthControl {
+public:
+    // heartbeat silence after which the daemon counts as gone
+    static const int TIMEOUT_MS = 1000;
+
+    ~RemoteControl();
+
+    // Fails if there is no daemon by that name or another GUI is connected
+    bool connect(const std::string& name, std::string& error);
+
+    bool setParameter(SynthParam param, float value) override;
+    float getParameter(SynthParam param) const override { return parameters[param]; }
+    void setQualityTier(QualityTier tier) override;
+    void toggleRecording() override;
+    Status status() override;
+    bool isConnected() const override;
+
+private:
+    bool send(const ControlCommand& command);
+    void poll();
+
+    SharedControlBlock* block = nullptr;
+    MeterFrame latest = {};
+    float parameters[PARAM_COUNT] = {};
+    uint64_t lastHeartbeat = 0;
+    std::chrono::steady_clock::time_point lastBeatTime;
+};
+
+#endif
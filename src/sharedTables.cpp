@@ -0,0 +1,41 @@
+#include "sharedTables.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+
+SharedTables::SharedTables() {
+    for (int n = 0; n < NOTE_COUNT; ++n) {
+        // fm = 2^((m - 69) / 12) * 440 Hz, m the MIDI note number
+        noteHz[n] = std::pow(2.0f, (static_cast<float>(n) - 69) / 12.0f) * 440;
+    }
+    for (int i = 0; i <= PREWARP_SIZE; ++i) prewarp[i] = std::tan(M_PI * PREWARP_MAX * i / PREWARP_SIZE);
+    for (int i = 0; i <= DECAY_SIZE; ++i) decay[i] = 1.0 - std::exp(-2.0 * M_PI * DECAY_MAX * i / DECAY_SIZE);
+}
+
+const SharedTables& sharedTables() {
+    static const SharedTables tables;
+    return tables;
+}
+
+typedef std::tuple<int, int, int> KernelKey;
+
+static std::mutex kernelsMutex;
+static std::map<KernelKey, std::shared_ptr<const std::vector<float>>> kernels;
+
+std::shared_ptr<const std::vector<float>> sharedResamplerKernel(int upFactor, int downFactor, int taps,
+                                                                KernelBuilder build) {
+    std::lock_guard<std::mutex> lock(kernelsMutex);
+    KernelKey key(upFactor, downFactor, taps);
+    auto found = kernels.find(key);
+    if (found != kernels.end()) return found->second;
+    std::shared_ptr<const std::vector<float>> kernel = std::make_shared<const std::vector<float>>(build(upFactor, downFactor, taps));
+    kernels[key] = kernel;
+    return kernel;
+}
+
+size_t sharedTablesBytes() {
+    size_t bytes = sizeof(SharedTables);
+    std::lock_guard<std::mutex> lock(kernelsMutex);
+    for (const auto& kernel : kernels) bytes += kernel.second->size() * sizeof(float);
+    return bytes;
+}
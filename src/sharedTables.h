@@ -0,0 +1,59 @@
+#ifndef SHAREDTABLES_H
+#define SHAREDTABLES_H
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Read-only tables shared by every voice of every engine in the process.
+// Built once on first use (sharedTables() is safe to call from any thread),
+// Synth touches them up front so the audio thread never builds them.
+struct SharedTables {
+    static const int NOTE_COUNT = 128;
+    // tan(pi * x) for x = cutoff / sample rate up to PREWARP_MAX, the bilinear prewarp
+    static const int PREWARP_SIZE = 4096;
+    static constexpr double PREWARP_MAX = 0.25;
+    // 1 - exp(-2 pi x) for x up to DECAY_MAX, the one-pole tuning of the Huovilainen ladder
+    static const int DECAY_SIZE = 4096;
+    static constexpr double DECAY_MAX = 0.25;
+
+    float noteHz[NOTE_COUNT];
+    double prewarp[PREWARP_SIZE + 1];
+    double decay[DECAY_SIZE + 1];
+
+    SharedTables();
+};
+
+const SharedTables& sharedTables();
+
+// Bytes held by sharedTables() and the resampler kernels built so far
+size_t sharedTablesBytes();
+
+// Linear interpolation into one of the tables above, the exact function
+// past the end of the table
+inline double lookupTable(const double* table, int size, double max, double x) {
+    double position = x * (size / max);
+    int i = static_cast<int>(position);
+    if (i < 0) i = 0;
+    double fraction = position - i;
+    return table[i] + (table[i + 1] - table[i]) * fraction;
+}
+
+inline double prewarpTan(double x) {
+    if (x >= SharedTables::PREWARP_MAX || x < 0.0) return std::tan(M_PI * x);
+    return lookupTable(sharedTables().prewarp, SharedTables::PREWARP_SIZE, SharedTables::PREWARP_MAX, x);
+}
+
+inline double onePoleDecay(double x) {
+    if (x >= SharedTables::DECAY_MAX || x < 0.0) return 1.0 - std::exp(-2.0 * M_PI * x);
+    return lookupTable(sharedTables().decay, SharedTables::DECAY_SIZE, SharedTables::DECAY_MAX, x);
+}
+
+// Polyphase resampler coefficients for an L/M ratio and tap count, built the
+// first time they are asked for and shared by every Resampler after that
+typedef std::vector<float> (*KernelBuilder)(int upFactor, int downFactor, int taps);
+std::shared_ptr<const std::vector<float>> sharedResamplerKernel(int upFactor, int downFactor, int taps,
+                                                                KernelBuilder build);
+
+#endif
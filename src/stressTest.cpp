@@ -0,0 +1,293 @@
+#include "stressTest.h"
+#include "rtCheck.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#include <sanitizer/allocator_interface.h>
+#define STRESS_MALLOC_HOOKS 1
+#endif
+
+static const uint32_t NOTE_SEED = 1234;
+static const uint32_t PARAM_SEED = 5678;
+static const int LOWEST_NOTE = 36;
+static const int NOTE_SPAN = 48;
+static const int MAX_HELD = 16;
+static const int MAX_NOTE_BURST = 64;
+// now and then a burst bigger than the queue, so the producer has to wait on it
+static const int FLOOD_BURST = 3000;
+static const int MAX_PARAM_BURST = 32;
+static const double DRAIN_TIMEOUT_SECONDS = 5.0;
+static const double PROGRESS_SECONDS = 10.0;
+
+// The note on/offs the producer sends. The checker runs a second copy with
+// the same seed to know what should come out of the queue next.
+class NoteStream {
+public:
+    explicit NoteStream(uint32_t seed) : random(seed) {}
+
+    SynthEvent next() {
+        SynthEvent event = {};
+        int i;
+        if (heldCount > 0 && (heldCount >= MAX_HELD || random() % 2 == 0)) {
+            i = static_cast<int>(random() % NOTE_SPAN);
+            while (!held[i]) i = (i + 1) % NOTE_SPAN;
+            event.type = EVENT_NOTE_OFF;
+            held[i] = false;
+            --heldCount;
+        }
+        else {
+            i = static_cast<int>(random() % NOTE_SPAN);
+            while (held[i]) i = (i + 1) % NOTE_SPAN;
+            event.type = EVENT_NOTE_ON;
+            held[i] = true;
+            ++heldCount;
+        }
+        event.note = static_cast<uint8_t>(LOWEST_NOTE + i);
+        event.velocity = static_cast<uint8_t>(1 + random() % 127);
+        return event;
+    }
+
+private:
+    std::minstd_rand random;
+    bool held[NOTE_SPAN] = {};
+    int heldCount = 0;
+};
+
+// Same idea for parameter changes, always in range so the engine's clamp
+// leaves them alone
+class ParamStream {
+public:
+    explicit ParamStream(uint32_t seed) : random(seed) {}
+
+    void next(SynthParam& param, float& value) {
+        param = static_cast<SynthParam>(random() % PARAM_COUNT);
+        const SynthParamInfo& info = synthParamInfo(param);
+        float position = static_cast<float>(random() - random.min()) / (random.max() - random.min());
+        value = std::min(std::max(info.min + (info.max - info.min) * position, info.min), info.max);
+    }
+
+private:
+    std::minstd_rand random;
+};
+
+// Rendering thread only
+struct StressCheck {
+    NoteStream expectedNotes{NOTE_SEED};
+    ParamStream expectedParams{PARAM_SEED};
+    uint64_t notesApplied = 0;
+    uint64_t paramsApplied = 0;
+    uint64_t mismatches = 0;
+    uint64_t firstMismatch = 0;     // index in its stream
+    bool firstMismatchIsNote = false;
+};
+
+static void checkEvent(const SynthEvent& event, void* context) {
+    StressCheck* check = static_cast<StressCheck*>(context);
+    bool ok;
+    uint64_t index;
+    if (event.type == EVENT_PARAMETER) {
+        SynthParam param;
+        float value;
+        check->expectedParams.next(param, value);
+        ok = event.param == param && event.value == value;
+        index = check->paramsApplied++;
+    }
+    else {
+        SynthEvent expected = check->expectedNotes.next();
+        ok = event.type == expected.type && event.note == expected.note && event.velocity == expected.velocity;
+        index = check->notesApplied++;
+    }
+    if (!ok && check->mismatches++ == 0) {
+        check->firstMismatch = index;
+        check->firstMismatchIsNote = event.type != EVENT_PARAMETER;
+    }
+}
+
+#ifdef STRESS_MALLOC_HOOKS
+static thread_local bool inRender = false;
+static std::atomic<uint64_t> renderAllocations(0);
+
+static void mallocHook(const volatile void*, size_t) {
+    if (inRender) renderAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void freeHook(const volatile void*) {
+    if (inRender) renderAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+// Bursts of events as fast as the queue takes them, with pauses in between
+static void noteProducer(SynthEngine* engine, const std::atomic<bool>& stop, std::atomic<uint64_t>& sent,
+                         std::atomic<uint64_t>& queueFull, std::atomic<int>& finished) {
+    NoteStream notes(NOTE_SEED);
+    std::minstd_rand timing(1);
+    while (!stop.load(std::memory_order_relaxed)) {
+        int burst = timing() % 50 == 0 ? FLOOD_BURST : 1 + static_cast<int>(timing() % MAX_NOTE_BURST);
+        for (int i = 0; i < burst; ++i) {
+            SynthEvent event = notes.next();
+            event.receivedNs = steadyNowNs();
+            while (!engine->pushEvent(event)) {
+                queueFull.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+            sent.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (timing() % 4 != 0) std::this_thread::sleep_for(std::chrono::microseconds(timing() % 2000));
+    }
+    ++finished;
+}
+
+static void paramProducer(SynthEngine* engine, const std::atomic<bool>& stop, std::atomic<uint64_t>& sent,
+                          std::atomic<uint64_t>& queueFull, std::atomic<int>& finished) {
+    ParamStream params(PARAM_SEED);
+    std::minstd_rand timing(2);
+    while (!stop.load(std::memory_order_relaxed)) {
+        int burst = 1 + static_cast<int>(timing() % MAX_PARAM_BURST);
+        for (int i = 0; i < burst; ++i) {
+            SynthParam param;
+            float value;
+            params.next(param, value);
+            while (!engine->setParameter(param, value)) {
+                queueFull.fetch_add(1, std::memory_order_relaxed);
+                std::this_thread::yield();
+            }
+            sent.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (timing() % 4 != 0) std::this_thread::sleep_for(std::chrono::microseconds(timing() % 5000));
+    }
+    ++finished;
+}
+
+// What the GUI and the stats thread read while the audio runs
+static void statsReader(SynthEngine* engine, const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        for (int p = 0; p < PARAM_COUNT; ++p) engine->getParameter(static_cast<SynthParam>(p));
+        engine->getStats().snapshot();
+        engine->getLatencyStats().snapshot();
+        engine->getGovernor().snapshot();
+        engine->getCycleStats().snapshot();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+static void qualitySwitcher(SynthEngine* engine, const std::atomic<bool>& stop) {
+    std::minstd_rand random(3);
+    while (!stop.load(std::memory_order_relaxed)) {
+        engine->setQualityTier(static_cast<QualityTier>(random() % QUALITY_TIER_COUNT));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1 + random() % 50));
+    }
+}
+
+bool runStressTest(SynthEngine* engine, double seconds, unsigned int blockFrames) {
+    const unsigned int channels = 2;
+    std::vector<float> buffer(blockFrames * channels);
+    // whatever is already queued (the Synth's default parameters) isn't ours to check
+    engine->render(buffer.data(), blockFrames, channels);
+    StressCheck check;
+    engine->setEventHook(checkEvent, &check);
+#ifdef STRESS_MALLOC_HOOKS
+    static bool hooksInstalled = false;
+    if (!hooksInstalled) hooksInstalled = __sanitizer_install_malloc_and_free_hooks(mallocHook, freeHook) != 0;
+#endif
+
+    std::atomic<bool> stopProducers(false);
+    std::atomic<bool> stopReaders(false);
+    std::atomic<int> producersFinished(0);
+    std::atomic<uint64_t> notesSent(0), paramsSent(0), notesFull(0), paramsFull(0);
+    std::cout << "Stress test: " << seconds << " s, " << blockFrames << " frame blocks, 2 producer and 2 reader threads"
+              << std::endl;
+    std::thread notes(noteProducer, engine, std::cref(stopProducers), std::ref(notesSent), std::ref(notesFull),
+                      std::ref(producersFinished));
+    std::thread params(paramProducer, engine, std::cref(stopProducers), std::ref(paramsSent), std::ref(paramsFull),
+                       std::ref(producersFinished));
+    std::thread reader(statsReader, engine, std::cref(stopReaders));
+    std::thread switcher(qualitySwitcher, engine, std::cref(stopReaders));
+
+    uint64_t blocks = 0;
+    uint64_t nonFinite = 0;
+    float peak = 0.0f;
+    bool drained = false;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+    double nextProgress = PROGRESS_SECONDS;
+    while (true) {
+#ifdef STRESS_MALLOC_HOOKS
+        inRender = true;
+#endif
+        {
+            RtCheckScope realtime;
+            engine->render(buffer.data(), blockFrames, channels);
+        }
+#ifdef STRESS_MALLOC_HOOKS
+        inRender = false;
+#endif
+        ++blocks;
+        for (float sample : buffer) {
+            if (!std::isfinite(sample)) ++nonFinite;
+            else peak = std::max(peak, std::fabs(sample));
+        }
+
+        double now = elapsed();
+        if (now >= nextProgress) {
+            std::cout << std::fixed << std::setprecision(0) << now << " s: " << check.notesApplied << " notes, "
+                      << check.paramsApplied << " parameters" << std::endl;
+            nextProgress += PROGRESS_SECONDS;
+        }
+        if (now < seconds) continue;
+        // keep rendering while the producers finish their last burst, they
+        // may be waiting on a full queue; then until everything they sent is out
+        stopProducers.store(true);
+        if (producersFinished.load() == 2 && check.notesApplied == notesSent.load() &&
+            check.paramsApplied == paramsSent.load()) {
+            drained = true;
+            break;
+        }
+        if (now > seconds + DRAIN_TIMEOUT_SECONDS) break;
+    }
+    stopReaders.store(true);
+    notes.join();
+    params.join();
+    reader.join();
+    switcher.join();
+    engine->setEventHook(nullptr, nullptr);
+
+    bool ok = drained && check.mismatches == 0 && nonFinite == 0;
+    std::cout << std::fixed << std::setprecision(1) << "rendered " << blocks << " blocks in " << elapsed() << " s"
+              << std::endl;
+    std::cout << "notes: " << notesSent.load() << " sent, " << check.notesApplied << " applied, queue full "
+              << notesFull.load() << " times" << std::endl;
+    std::cout << "parameters: " << paramsSent.load() << " sent, " << check.paramsApplied << " applied, queue full "
+              << paramsFull.load() << " times" << std::endl;
+    if (check.mismatches > 0) {
+        std::cout << check.mismatches << " events out of order or corrupted, the first was "
+                  << (check.firstMismatchIsNote ? "note" : "parameter") << " event " << check.firstMismatch << std::endl;
+    }
+    if (!drained) std::cout << "events went missing, the queues didn't drain" << std::endl;
+    std::cout << std::setprecision(3) << "output: " << nonFinite << " non-finite samples, peak " << peak << std::endl;
+#if defined(STRESS_MALLOC_HOOKS)
+    uint64_t allocations = renderAllocations.load();
+    std::cout << "heap calls on the render thread: " << allocations << std::endl;
+    if (allocations > 0) ok = false;
+#else
+    if (RTCHECK_ENABLED) {
+        uint64_t violations = rtCheckViolations();
+        std::cout << "heap and mutex calls on the render thread: " << violations << std::endl;
+        if (violations > 0) {
+            rtCheckReport();
+            ok = false;
+        }
+    }
+    else {
+        std::cout << "heap calls on the render thread: not checked, needs an ASan, TSan or RTCHECK=1 build" << std::endl;
+    }
+#endif
+    std::cout << (ok ? "PASSED" : "FAILED") << std::endl;
+    return ok;
+}
@@ -0,0 +1,20 @@
+#ifndef STRESSTEST_H
+#define STRESSTEST_H
+
+#include "synthEngine.h"
+
+// Renders flat out for `seconds` while other threads hammer the engine the
+// way the real program does: one thread pushing bursts of note on/offs (the
+// MIDI callback's role), one setting parameters in bursts (the GUI's), and
+// two more on the any-thread calls, reading every statistic and switching
+// the quality tier. The engine's queues are single producer, so there is one
+// thread per queue, as in the real program.
+//
+// Checks that every event comes out of the queues once and in order, that
+// the output stays finite and, in a sanitizer build (ASan or TSan), that the
+// rendering thread never allocates; a `make RTCHECK=1` build checks it for
+// mutex calls as well, see rtCheck.h. Build with `make SANITIZE=thread` to
+// run it under ThreadSanitizer. Returns true if all of that held.
+bool runStressTest(SynthEngine* engine, double seconds, unsigned int blockFrames);
+
+#endif
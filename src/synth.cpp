@@ -0,0 +1,63 @@
+#include "synth.h"
+#include "sharedTables.h"
+#include "stk/Stk.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/allocator_interface.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// What the allocator has handed out and not got back, 0 where we can't tell
+static size_t heapBytesInUse() {
+#if defined(__SANITIZE_ADDRESS__)
+    return __sanitizer_get_current_allocated_bytes();
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+Synth::Synth(const SynthConfig& inputConfig) : config(inputConfig) {
+    // built once for the whole process, not this instance's memory
+    sharedTables();
+    size_t heapBefore = heapBytesInUse();
+    size_t sharedBefore = sharedTablesBytes();
+
+    if (config.renderRate <= 0) config.renderRate = config.sampleRate;
+    if (config.renderRate != config.sampleRate
+        && !Resampler::supports(static_cast<int>(config.renderRate), static_cast<int>(config.sampleRate))) {
+        config.renderRate = config.sampleRate;
+    }
+    if (config.voices < 1) config.voices = 1;
+
+    // before any voice exists: the BLIT oscillators, the envelopes and the
+    // polyBLEP phase increments all read it when they are set up
+    stk::Stk::setSampleRate(config.renderRate);
+
+    for (int i = 0; i < config.voices; ++i) {
+        voices.emplace_back(new Voice(config.renderRate));
+        voicePointers.push_back(voices.back().get());
+    }
+    allocator.reset(new voiceAllocator(voicePointers.data(), config.voices));
+    engine.reset(new SynthEngine(voicePointers.data(), config.voices, allocator.get(), config.sampleRate,
+                                 config.maxFrames));
+    engine->setRenderRate(config.renderRate);
+
+    size_t shared = sharedTablesBytes() - sharedBefore;
+    size_t heap = heapBytesInUse() - heapBefore;
+    memoryBytes = sizeof(Synth) + (heap > shared ? heap - shared : 0);
+
+    // so the voices match what getParameter() reports from the first block on
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        SynthParam param = static_cast<SynthParam>(p);
+        engine->setParameter(param, synthParamInfo(param).defaultValue);
+    }
+}
+
+// the engine and the allocator point into the voices, so they go first
+Synth::~Synth() {
+    engine.reset();
+    allocator.reset();
+}
@@ -0,0 +1,45 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "voice.h"
+#include "voiceAllocator.h"
+#include "synthEngine.h"
+#include <memory>
+#include <vector>
+
+struct SynthConfig {
+    double sampleRate = 48000;      // of the output
+    double renderRate = 0;          // of the voices, 0 = sampleRate
+    unsigned int maxFrames = 512;   // largest block render() will be asked for
+    int voices = 8;
+};
+
+// The voices, the allocator and the engine in one piece, with no GUI or audio
+// device attached. Whoever owns it drives getEngine()->render() from their own
+// audio callback and feeds it notes and parameters.
+//
+// Stk keeps a single global sample rate, so every Synth in a process has to
+// run at the same render rate.
+class Synth {
+public:
+    explicit Synth(const SynthConfig& config);
+    ~Synth();
+
+    SynthEngine* getEngine() { return engine.get(); }
+    Voice** getVoices() { return voicePointers.data(); }
+    int getVoiceCount() const { return static_cast<int>(voicePointers.size()); }
+    const SynthConfig& getConfig() const { return config; }
+    // Heap this instance allocated when it was built, the shared tables not
+    // counted. Only exact if no other thread was allocating at the time.
+    size_t getMemoryBytes() const { return memoryBytes; }
+
+private:
+    SynthConfig config;
+    std::vector<std::unique_ptr<Voice>> voices;
+    std::vector<Voice*> voicePointers;
+    std::unique_ptr<voiceAllocator> allocator;
+    std::unique_ptr<SynthEngine> engine;
+    size_t memoryBytes = 0;
+};
+
+#endif
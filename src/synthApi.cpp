@@ -0,0 +1,83 @@
+#include "synthApi.h"
+#include "synth.h"
+#include "synthEvent.h"
+#include "synthParameters.h"
+#include "quality.h"
+
+struct new_synth {
+    Synth synth;
+    explicit new_synth(const SynthConfig& config) : synth(config) {}
+};
+
+static bool sendNote(new_synth* synth, SynthEventType type, int note, int velocity) {
+    if (note < 0 || note > 127) return false;
+    SynthEvent event = {};
+    event.type = type;
+    event.note = static_cast<uint8_t>(note);
+    event.velocity = static_cast<uint8_t>(velocity);
+    event.receivedNs = steadyNowNs();
+    return synth->synth.getEngine()->pushEvent(event);
+}
+
+extern "C" {
+
+new_synth* new_synth_create(double sample_rate, unsigned int max_frames, int voices) {
+    if (sample_rate <= 0 || max_frames == 0 || voices < 1) return nullptr;
+    SynthConfig config;
+    config.sampleRate = sample_rate;
+    config.maxFrames = max_frames;
+    config.voices = voices;
+    return new new_synth(config);
+}
+
+void new_synth_destroy(new_synth* synth) {
+    delete synth;
+}
+
+int new_synth_note_on(new_synth* synth, int note, int velocity) {
+    // running status players send note-offs as velocity 0 note-ons
+    if (velocity <= 0) return sendNote(synth, EVENT_NOTE_OFF, note, 0);
+    return sendNote(synth, EVENT_NOTE_ON, note, velocity > 127 ? 127 : velocity);
+}
+
+int new_synth_note_off(new_synth* synth, int note) {
+    return sendNote(synth, EVENT_NOTE_OFF, note, 0);
+}
+
+int new_synth_param_count(void) {
+    return PARAM_COUNT;
+}
+
+const char* new_synth_param_name(int param) {
+    if (param < 0 || param >= PARAM_COUNT) return nullptr;
+    return synthParamInfo(static_cast<SynthParam>(param)).name;
+}
+
+int new_synth_find_param(const char* name) {
+    if (!name) return -1;
+    SynthParam param = findSynthParam(name);
+    return param == PARAM_COUNT ? -1 : param;
+}
+
+int new_synth_set_param(new_synth* synth, int param, float value) {
+    if (param < 0 || param >= PARAM_COUNT) return 0;
+    return synth->synth.getEngine()->setParameter(static_cast<SynthParam>(param), value);
+}
+
+float new_synth_get_param(new_synth* synth, int param) {
+    if (param < 0 || param >= PARAM_COUNT) return 0.0f;
+    return synth->synth.getEngine()->getParameter(static_cast<SynthParam>(param));
+}
+
+int new_synth_set_quality(new_synth* synth, const char* tier) {
+    QualityTier value;
+    if (!tier || !parseQualityTier(tier, value)) return 0;
+    synth->synth.getEngine()->setQualityTier(value);
+    return 1;
+}
+
+void new_synth_render(new_synth* synth, float* out, unsigned int frames, unsigned int channels) {
+    synth->synth.getEngine()->render(out, frames, channels);
+}
+
+}
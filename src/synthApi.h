@@ -0,0 +1,45 @@
+#ifndef SYNTHAPI_H
+#define SYNTHAPI_H
+
+// Plain C interface to the engine, for hosts that aren't C++ (or don't want
+// our headers). Link against libnew_synth_engine.a plus -lstk -lpthread.
+//
+// Threading: render() belongs to one audio thread. Notes may come from one
+// other thread and parameters from one more (each has its own single-producer
+// queue), both are applied at the start of the next render(). create and
+// destroy must not overlap with anything else on the same synth.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct new_synth new_synth;
+
+// NULL if the arguments make no sense. Every synth in a process has to use
+// the same sample rate (Stk keeps it in a global).
+new_synth* new_synth_create(double sample_rate, unsigned int max_frames, int voices);
+void new_synth_destroy(new_synth* synth);
+
+// 0 if the note queue is full
+int new_synth_note_on(new_synth* synth, int note, int velocity);
+int new_synth_note_off(new_synth* synth, int note);
+
+// Parameters by index, 0 .. new_synth_param_count()-1. The value is clamped
+// to the parameter's range. set returns 0 for a bad index or a full queue.
+int new_synth_param_count(void);
+const char* new_synth_param_name(int param);
+int new_synth_find_param(const char* name);   // -1 if unknown
+int new_synth_set_param(new_synth* synth, int param, float value);
+float new_synth_get_param(new_synth* synth, int param);
+
+// "eco", "standard" or "high", returns 0 for anything else
+int new_synth_set_quality(new_synth* synth, const char* tier);
+
+// Interleaved float output, frames at most max_frames
+void new_synth_render(new_synth* synth, float* out, unsigned int frames, unsigned int channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
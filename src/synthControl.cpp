@@ -0,0 +1,28 @@
+#include "synthControl.h"
+#include <ctime>
+
+LocalControl::LocalControl(SynthEngine* engine, Recorder* recorder, const std::string& recordPath, int recordBits)
+    : engine(engine), recorder(recorder), recordPath(recordPath), recordBits(recordBits) {}
+
+void LocalControl::toggleRecording() {
+    if (recorder->isRecording()) {
+        recorder->stop();
+        return;
+    }
+    std::string path = recordPath;
+    if (path.empty()) path = "recording-" + std::to_string(static_cast<long long>(std::time(nullptr))) + ".wav";
+    recorder->start(path, recordBits);
+}
+
+SynthControl::Status LocalControl::status() {
+    Status s;
+    s.engine = engine->getStats().snapshot();
+    s.latency = engine->getLatencyStats().snapshot();
+    s.governor = engine->getGovernor().snapshot();
+    s.quality = engine->getQualityTier();
+    Recorder::Snapshot r = recorder->snapshot();
+    s.recording = r.recording;
+    s.recordedSeconds = static_cast<double>(r.framesWritten) / recorder->getSampleRate();
+    s.recordOverruns = r.overruns;
+    return s;
+}
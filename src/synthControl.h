@@ -0,0 +1,58 @@
+#ifndef SYNTHCONTROL_H
+#define SYNTHCONTROL_H
+
+#include "synthEngine.h"
+#include "recorder.h"
+#include <string>
+#include <vector>
+
+// What the GUI talks to: the engine in this process, or one running as a
+// daemon in another (see sharedControl.h). Everything here is called from
+// the GUI thread only.
+class SynthControl {
+public:
+    // Plain data, it is copied through shared memory as is
+    struct Status {
+        EngineStats::Snapshot engine;
+        LatencyStats::Snapshot latency;
+        PolyphonyGovernor::Snapshot governor;
+        QualityTier quality;
+        bool recording;
+        double recordedSeconds;
+        uint64_t recordOverruns;
+    };
+
+    virtual ~SynthControl() {}
+
+    virtual bool setParameter(SynthParam param, float value) = 0;
+    virtual float getParameter(SynthParam param) const = 0;
+    virtual void setQualityTier(QualityTier tier) = 0;
+    virtual void toggleRecording() = 0;
+    virtual Status status() = 0;
+    // --profile-every rows, only available in-process
+    virtual std::vector<CycleStats::Row> cycleRows() { return std::vector<CycleStats::Row>(); }
+    // false once a daemon has stopped answering
+    virtual bool isConnected() const { return true; }
+};
+
+// The engine and recorder in this process
+class LocalControl : public SynthControl {
+public:
+    // An empty recordPath gives every recording its own timestamped name
+    LocalControl(SynthEngine* engine, Recorder* recorder, const std::string& recordPath, int recordBits);
+
+    bool setParameter(SynthParam param, float value) override { return engine->setParameter(param, value); }
+    float getParameter(SynthParam param) const override { return engine->getParameter(param); }
+    void setQualityTier(QualityTier tier) override { engine->setQualityTier(tier); }
+    void toggleRecording() override;
+    Status status() override;
+    std::vector<CycleStats::Row> cycleRows() override { return engine->getCycleStats().snapshot(); }
+
+private:
+    SynthEngine* engine;
+    Recorder* recorder;
+    std::string recordPath;
+    int recordBits;
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include "synthEngine.h"
+#include "midiFilePlayer.h"
+#include "trace.h"
+#include "probes.h"
+#include <cmath>
+
+static_assert(PARAM_COUNT <= 32, "pendingParameterMask has one bit per parameter");
+
+// Anything quieter than this doesn't count as the voice being heard
+static const float SILENCE_THRESHOLD = 1.0e-6f;
+// Released voices below this envelope level are cut off when the governor asks for it
+static const float TAIL_LEVEL = 0.05f;
+
+SynthEngine::SynthEngine(Voice* voices[], int nVoices, voiceAllocator* allocator, double sampleRate, unsigned int maxFrames)
+    : voices(voices), nVoices(nVoices), allocator(allocator), sampleRate(sampleRate), renderRate(sampleRate),
+      maxFrames(maxFrames),
+      monoBuffer(maxFrames, 0.0f), voiceBuffer(maxFrames, 0.0f), pendingNoteOnNs(nVoices, 0),
+      events(EVENT_QUEUE_SIZE), parameterEvents(EVENT_QUEUE_SIZE) {
+    for (int p = 0; p < PARAM_COUNT; ++p) parameters[p].store(synthParamInfo(static_cast<SynthParam>(p)).defaultValue);
+}
+
+bool SynthEngine::setRenderRate(double rate) {
+    if (rate == sampleRate) {
+        resampler.reset();
+        renderRate = rate;
+        return true;
+    }
+    int from = static_cast<int>(rate);
+    int to = static_cast<int>(sampleRate);
+    if (!Resampler::supports(from, to)) return false;
+    resampler.reset(new Resampler(from, to, maxFrames));
+    resampledBuffer.assign(maxFrames, 0.0f);
+    renderRate = rate;
+    return true;
+}
+
+bool SynthEngine::pushEvent(const SynthEvent& event) {
+    if (event.type != EVENT_PARAMETER) return events.write(&event, 1);
+    if (event.param >= PARAM_COUNT) return false;
+    const SynthParamInfo& info = synthParamInfo(static_cast<SynthParam>(event.param));
+    SynthEvent clamped = event;
+    if (clamped.value < info.min) clamped.value = info.min;
+    if (clamped.value > info.max) clamped.value = info.max;
+    parameters[event.param].store(clamped.value, std::memory_order_relaxed);
+    return events.write(&clamped, 1);
+}
+
+bool SynthEngine::setParameter(SynthParam param, float value) {
+    if (param >= PARAM_COUNT) return false;
+    const SynthParamInfo& info = synthParamInfo(param);
+    if (value < info.min) value = info.min;
+    if (value > info.max) value = info.max;
+    parameters[param].store(value, std::memory_order_relaxed);
+    SynthEvent event = {};
+    event.type = EVENT_PARAMETER;
+    event.param = param;
+    event.value = value;
+    return parameterEvents.write(&event, 1);
+}
+
+// Parameters first, so notes in the same block start with the new settings
+int SynthEngine::processEvents() {
+    int count = 0;
+    SynthEvent event;
+    while (parameterEvents.read(&event, 1)) {
+        ++count;
+        applyEvent(event);
+    }
+    while (events.read(&event, 1)) {
+        ++count;
+        applyEvent(event);
+    }
+    applyPendingControls();
+    return count;
+}
+
+void SynthEngine::applyEvent(const SynthEvent& event) {
+    if (eventHook) eventHook(event, eventHookContext);
+    if (event.type == EVENT_NOTE_ON) {
+        int voice = allocator->noteOn(midiNoteToHz(event.note));
+        SYNTH_PROBE3(note_on, event.note, event.velocity, voice);
+        if (voice >= 0) pendingNoteOnNs[voice] = event.receivedNs;
+    }
+    else if (event.type == EVENT_NOTE_OFF) {
+        allocator->noteOff(midiNoteToHz(event.note));
+        SYNTH_PROBE1(note_off, event.note);
+    }
+    else if (event.type == EVENT_PARAMETER && event.param < PARAM_COUNT) {
+        pendingParameters[event.param] = event.value;
+        pendingParameterMask |= 1u << event.param;
+    }
+    else if (event.type == EVENT_PITCH_BEND) {
+        pendingBend = event.value;
+        bendPending = true;
+    }
+    else if (event.type == EVENT_ALL_NOTES_OFF) {
+        allocator->allNotesOff();
+    }
+    else if (event.type == EVENT_ALL_SOUND_OFF) {
+        allocator->allNotesOff();
+        for (int i = 0; i < nVoices; ++i) voices[i]->kill();
+    }
+    else if (event.type == EVENT_QUALITY && event.param < QUALITY_TIER_COUNT) {
+        requestedTier.store(static_cast<QualityTier>(event.param), std::memory_order_relaxed);
+        applyQualityTier();
+    }
+}
+
+// Nothing is rendered between the events of one batch, so only the last
+// value of each control matters
+void SynthEngine::applyPendingControls() {
+    for (int p = 0; pendingParameterMask != 0; ++p) {
+        if (!(pendingParameterMask & (1u << p))) continue;
+        pendingParameterMask &= ~(1u << p);
+        applyParameter(static_cast<SynthParam>(p), pendingParameters[p]);
+    }
+    if (bendPending) {
+        for (int i = 0; i < nVoices; ++i) voices[i]->setPitchBend(pendingBend);
+        bendPending = false;
+    }
+}
+
+void SynthEngine::applyParameter(SynthParam param, float value) {
+    for (int i = 0; i < nVoices; ++i) {
+        Voice* voice = voices[i];
+        switch (param) {
+            case PARAM_OSC1_TUNE: voice->setOscDetune(1, value); break;
+            case PARAM_OSC2_TUNE: voice->setOscDetune(2, value); break;
+            case PARAM_OSC1_WAVEFORM: voice->setOscWaveform(1, value >= 0.5f ? SQUARE : SAW); break;
+            case PARAM_OSC2_WAVEFORM: voice->setOscWaveform(2, value >= 0.5f ? SQUARE : SAW); break;
+            case PARAM_OSC1_VOLUME: voice->setOscVolume(1, value); break;
+            case PARAM_OSC2_VOLUME: voice->setOscVolume(2, value); break;
+            case PARAM_XMOD: voice->setXModVolume(value); break;
+            case PARAM_CUTOFF: voice->setCutoff(value); break;
+            case PARAM_RESONANCE: voice->setResonance(value); break;
+            case PARAM_FEG_AMOUNT: voice->setFegAmount(value); break;
+            case PARAM_AEG_ATTACK: voice->setAegAttack(value); break;
+            case PARAM_AEG_DECAY: voice->setAegDecay(value); break;
+            case PARAM_AEG_SUSTAIN: voice->setAegSustain(value); break;
+            case PARAM_AEG_RELEASE: voice->setAegRelease(value); break;
+            case PARAM_FEG_ATTACK: voice->setFegAttack(value); break;
+            case PARAM_FEG_DECAY: voice->setFegDecay(value); break;
+            case PARAM_FEG_SUSTAIN: voice->setFegSustain(value); break;
+            case PARAM_FEG_RELEASE: voice->setFegRelease(value); break;
+            default: break;
+        }
+    }
+}
+
+void SynthEngine::render(float* out, unsigned int nFrames, unsigned int nChannels) {
+    TraceSpan span("render block", nFrames);
+    SYNTH_PROBE2(block_start, blockCount, nFrames);
+    uint64_t blockStartNs = steadyNowNs();
+
+    applyQualityTier();
+    int nEvents = processEvents();
+    if (governor.getStage() >= PolyphonyGovernor::STEAL_TAILS) stealTails();
+
+    if (resampler) {
+        renderResampled(out, nFrames, nChannels, blockStartNs);
+    }
+    else {
+        // the device may ask for more than we planned for, render in chunks
+        unsigned int done = 0;
+        while (done < nFrames) {
+            unsigned int chunk = nFrames - done;
+            if (chunk > maxFrames) chunk = maxFrames;
+            renderVoices(monoBuffer.data(), chunk, done, blockStartNs);
+            float* frame = out + done * nChannels;
+            for (unsigned int n = 0; n < chunk; ++n) {
+                for (unsigned int c = 0; c < nChannels; ++c) *frame++ = monoBuffer[n];
+            }
+            done += chunk;
+        }
+    }
+
+    uint64_t renderNs = steadyNowNs() - blockStartNs;
+    uint64_t budgetNs = static_cast<uint64_t>(nFrames * 1.0e9 / sampleRate);
+    int active = activeVoiceCount();
+    stats.recordBlock(renderNs, budgetNs, active);
+    updateGovernor(renderNs, budgetNs);
+    recordFlight(blockStartNs, renderNs, budgetNs, nFrames, nEvents, active);
+    SYNTH_PROBE3(block_end, blockCount, renderNs, budgetNs);
+    if (renderNs > budgetNs) {
+        SYNTH_PROBE3(xrun, blockCount, renderNs, budgetNs);
+        flightRecorder.freeze("render over budget");
+    }
+    ++blockCount;
+}
+
+// The voices only ever produce a mono mix, so that is what gets converted,
+// once, before it is copied out to the channels. Voices render exactly as
+// many frames as the resampler asks for, nothing is rendered ahead.
+void SynthEngine::renderResampled(float* out, unsigned int nFrames, unsigned int nChannels, uint64_t blockStartNs) {
+    TraceSpan span("resample", nFrames);
+    unsigned int done = 0;
+    unsigned int rendered = 0;      // voice frames so far this block, where a note's first output lands
+    while (done < nFrames) {
+        unsigned int want = nFrames - done;
+        if (want > maxFrames) want = maxFrames;
+        unsigned int got = resampler->read(resampledBuffer.data(), want);
+        if (got == 0) {
+            unsigned int needed = resampler->inputNeeded(want);
+            if (needed > maxFrames) needed = maxFrames;
+            renderVoices(monoBuffer.data(), needed, rendered, blockStartNs);
+            resampler->write(monoBuffer.data(), needed);
+            rendered += needed;
+            continue;
+        }
+        float* frame = out + done * nChannels;
+        for (unsigned int n = 0; n < got; ++n) {
+            for (unsigned int c = 0; c < nChannels; ++c) *frame++ = resampledBuffer[n];
+        }
+        done += got;
+    }
+}
+
+void SynthEngine::applyQualityTier() {
+    QualityTier tier = requestedTier.load(std::memory_order_relaxed);
+    if (tier == currentTier) return;
+    SYNTH_PROBE2(quality_tier, currentTier, tier);
+    const QualitySettings& settings = qualitySettings(tier);
+    for (int i = 0; i < nVoices; ++i) voices[i]->setQuality(settings);
+    currentTier = tier;
+}
+
+void SynthEngine::stealTails() {
+    int stolen = 0;
+    for (int i = 0; i < nVoices; ++i) {
+        if (voices[i]->isReleasing() && voices[i]->envelopeLevel() < TAIL_LEVEL) {
+            voices[i]->kill();
+            ++stolen;
+        }
+    }
+    if (stolen > 0) governor.countTailsStolen(stolen);
+}
+
+void SynthEngine::updateGovernor(uint64_t renderNs, uint64_t budgetNs) {
+    typedef PolyphonyGovernor G;
+    G::Stage before = governor.getStage();
+    bool tighten = governor.update(renderNs, budgetNs);
+    G::Stage after = governor.getStage();
+
+    if (after != before) {
+        bool cheap = after >= G::CHEAP_KERNELS;
+        if (cheap != (before >= G::CHEAP_KERNELS)) {
+            for (int i = 0; i < nVoices; ++i) voices[i]->setFastSaturation(cheap);
+        }
+        if (after >= G::CAP_POLYPHONY && before < G::CAP_POLYPHONY) allocator->setVoiceLimit(activeVoiceCount() - 1);
+        if (after < G::CAP_POLYPHONY && before >= G::CAP_POLYPHONY) allocator->setVoiceLimit(nVoices);
+    }
+    else if (tighten) {
+        allocator->setVoiceLimit(allocator->getVoiceLimit() - 1);
+    }
+
+    governor.setVoiceLimit(allocator->getVoiceLimit());
+    governor.setNotesDropped(allocator->getNotesDropped());
+}
+
+void SynthEngine::recordFlight(uint64_t blockStartNs, uint64_t renderNs, uint64_t budgetNs, unsigned int nFrames,
+                               int nEvents, int active) {
+    FlightRecorder::BlockRecord* record = flightRecorder.begin();
+    if (!record) return;
+    record->block = blockCount;
+    record->startNs = blockStartNs;
+    record->renderNs = static_cast<uint32_t>(renderNs);
+    record->budgetNs = static_cast<uint32_t>(budgetNs);
+    record->frames = static_cast<uint16_t>(nFrames);
+    record->events = static_cast<uint16_t>(nEvents);
+    record->activeVoices = static_cast<uint16_t>(active);
+    record->nVoices = static_cast<uint16_t>(nVoices);
+    record->governorStage = static_cast<uint8_t>(governor.getStage());
+    for (int i = 0; i < nVoices && i < FlightRecorder::MAX_VOICES; ++i) {
+        record->voices[i].active = voices[i]->isActive();
+        record->voices[i].filterModel = voices[i]->getFilterModel();
+        record->voices[i].oversampling = static_cast<uint8_t>(voices[i]->getOversampling());
+    }
+    flightRecorder.commit();
+}
+
+// The file player's events fall between samples, render up to each one,
+// apply it and carry on
+void SynthEngine::renderVoices(float* out, unsigned int nFrames, unsigned int frameOffset, uint64_t blockStartNs) {
+    if (!player) {
+        renderMono(out, nFrames, frameOffset, blockStartNs);
+        return;
+    }
+    unsigned int done = 0;
+    while (done < nFrames) {
+        SynthEvent event;
+        while (player->nextDue(event)) applyEvent(event);
+        applyPendingControls();
+        unsigned int chunk = nFrames - done;
+        uint64_t untilNext = player->framesToNext();
+        if (untilNext < chunk) chunk = static_cast<unsigned int>(untilNext);
+        renderMono(out + done, chunk, frameOffset + done, blockStartNs);
+        player->advance(chunk);
+        done += chunk;
+    }
+}
+
+// One voice at a time over the whole block, so each voice's state stays in
+// cache and shows up as its own span in a trace
+void SynthEngine::renderMono(float* out, unsigned int nFrames, unsigned int frameOffset, uint64_t blockStartNs) {
+    bool profile = profileInterval > 0 && blockCount % profileInterval == 0;
+    const float gain = 1.0f / nVoices;
+    for (unsigned int n = 0; n < nFrames; ++n) out[n] = 0.0f;
+    for (int i = 0; i < nVoices; ++i) {
+        TraceSpan span("render voice", i);
+        Voice* voice = voices[i];
+        if (!voice->isActive()) continue;   // idle voices are silent, don't spend time on them
+        VoiceProfile voiceProfile;
+        voice->render(voiceBuffer.data(), nFrames, profile ? &voiceProfile : nullptr);
+        if (profile) cycleStats.add(voice->getFilterModel(), voice->getOscillatorType(), voiceProfile);
+        if (pendingNoteOnNs[i] != 0) checkFirstOutput(i, nFrames, frameOffset, blockStartNs);
+        for (unsigned int n = 0; n < nFrames; ++n) out[n] += voiceBuffer[n] * gain;
+    }
+}
+
+// Latency of a note-on = time it sat in the queue before this block started
+// + the position of the first audible sample in the block + the device latency
+void SynthEngine::checkFirstOutput(int voice, unsigned int nFrames, unsigned int frameOffset, uint64_t blockStartNs) {
+    for (unsigned int n = 0; n < nFrames; ++n) {
+        if (std::fabs(voiceBuffer[n]) > SILENCE_THRESHOLD) {
+            uint64_t receivedNs = pendingNoteOnNs[voice];
+            uint64_t queueNs = blockStartNs > receivedNs ? blockStartNs - receivedNs : 0;
+            uint64_t deviceNs = static_cast<uint64_t>(outputLatencyFrames * 1.0e9 / sampleRate +
+                                                      (frameOffset + n) * 1.0e9 / renderRate);
+            if (resampler) deviceNs += static_cast<uint64_t>(resampler->latencySeconds() * 1.0e9);
+            latency.record(queueNs + deviceNs, queueNs, deviceNs);
+            pendingNoteOnNs[voice] = 0;
+            return;
+        }
+    }
+}
+
+int SynthEngine::activeVoiceCount() const {
+    int count = 0;
+    for (int i = 0; i < nVoices; ++i) {
+        if (voices[i]->isActive()) ++count;
+    }
+    return count;
+}
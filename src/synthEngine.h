@@ -0,0 +1,140 @@
+#ifndef SYNTHENGINE_H
+#define SYNTHENGINE_H
+
+#include "voice.h"
+#include "voiceAllocator.h"
+#include "engineStats.h"
+#include "latencyStats.h"
+#include "flightRecorder.h"
+#include "cycleStats.h"
+#include "governor.h"
+#include "synthEvent.h"
+#include "synthParameters.h"
+#include "RingBuffer.h"
+#include "quality.h"
+#include "resampler.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class MidiFilePlayer;
+
+// Renders the voices a block at a time and keeps track of how long that took.
+// render() is called from the audio thread only. Note events come in through
+// pushEvent() from a single producer thread (the MIDI callback), parameter
+// changes through setParameter() from one other thread (the GUI); both are
+// applied at the start of the next block. A MidiFilePlayer's events are
+// applied on their exact frame instead.
+class SynthEngine {
+public:
+    static const size_t EVENT_QUEUE_SIZE = 1024;
+
+    // Called on the audio thread with every event as it is applied, for tools
+    // that check what came out of the queues. Must not block.
+    typedef void (*EventHook)(const SynthEvent& event, void* context);
+
+    SynthEngine(Voice* voices[], int nVoices, voiceAllocator* allocator, double sampleRate, unsigned int maxFrames);
+
+    // Renders nFrames of interleaved audio, the mono mix copied to every channel
+    void render(float* out, unsigned int nFrames, unsigned int nChannels);
+
+    // Producer side of the event queue. Returns false if the queue is full.
+    // A parameter event's value is clamped and recorded like setParameter()'s,
+    // that is how MIDI controllers reach the parameters.
+    bool pushEvent(const SynthEvent& event);
+
+    // Producer side of the parameter queue, value is clamped to the
+    // parameter's range. Returns false if the queue is full.
+    bool setParameter(SynthParam param, float value);
+    // The last value set, applied or not yet
+    float getParameter(SynthParam param) const { return parameters[param].load(std::memory_order_relaxed); }
+
+    // Render the voices at renderRate and convert the mix to the device rate.
+    // The voices must have been built for renderRate. Call before the first
+    // render(); returns false if the two rates can't be converted between.
+    bool setRenderRate(double renderRate);
+
+    // Frames between handing a block to the device and it being heard,
+    // used for the latency estimate
+    void setOutputLatency(unsigned int frames) { outputLatencyFrames = frames; }
+
+    // Set before the first render(), nullptr removes it
+    void setEventHook(EventHook hook, void* context) {
+        eventHook = hook;
+        eventHookContext = context;
+    }
+
+    // Play a MIDI file on the audio clock, starting with the next render().
+    // Its events go through the same path as the queue's but land on their
+    // own frame, the block is split around them. Set before the first
+    // render(), nullptr removes it. The player must outlive the engine's use of it.
+    void setPlayer(MidiFilePlayer* player) { this->player = player; }
+
+    // Time the stages of every voice on one block in `blocks`, 0 turns it off
+    void setProfileInterval(unsigned int blocks) { profileInterval = blocks; }
+
+    // Any thread. Picked up at the start of the next block.
+    void setQualityTier(QualityTier tier) { requestedTier.store(tier, std::memory_order_relaxed); }
+    QualityTier getQualityTier() const { return requestedTier.load(std::memory_order_relaxed); }
+
+    int activeVoiceCount() const;
+    int getVoiceCount() const { return nVoices; }
+    double getSampleRate() const { return sampleRate; }
+    double getRenderRate() const { return renderRate; }
+    EngineStats& getStats() { return stats; }
+    LatencyStats& getLatencyStats() { return latency; }
+    FlightRecorder& getFlightRecorder() { return flightRecorder; }
+    CycleStats& getCycleStats() { return cycleStats; }
+    PolyphonyGovernor& getGovernor() { return governor; }
+
+private:
+    int processEvents();
+    void applyEvent(const SynthEvent& event);
+    void applyParameter(SynthParam param, float value);
+    void applyPendingControls();
+    void applyQualityTier();
+    void stealTails();
+    void updateGovernor(uint64_t renderNs, uint64_t budgetNs);
+    void recordFlight(uint64_t blockStartNs, uint64_t renderNs, uint64_t budgetNs, unsigned int nFrames, int nEvents, int active);
+    void renderVoices(float* out, unsigned int nFrames, unsigned int frameOffset, uint64_t blockStartNs);
+    void renderMono(float* out, unsigned int nFrames, unsigned int frameOffset, uint64_t blockStartNs);
+    void renderResampled(float* out, unsigned int nFrames, unsigned int nChannels, uint64_t blockStartNs);
+    void checkFirstOutput(int voice, unsigned int nFrames, unsigned int frameOffset, uint64_t blockStartNs);
+
+    Voice** voices;
+    int nVoices;
+    voiceAllocator* allocator;
+    double sampleRate;          // of the device
+    double renderRate;          // of the voices, the same unless resampling
+    unsigned int maxFrames;
+    unsigned int outputLatencyFrames = 0;
+    unsigned int profileInterval = 0;
+    std::vector<float> monoBuffer;
+    std::vector<float> voiceBuffer;
+    std::unique_ptr<Resampler> resampler;
+    std::vector<float> resampledBuffer;
+    std::vector<uint64_t> pendingNoteOnNs;   // per voice, receive time of a note-on not heard yet
+    RingBufferT<SynthEvent> events;
+    RingBufferT<SynthEvent> parameterEvents;
+    EventHook eventHook = nullptr;
+    void* eventHookContext = nullptr;
+    MidiFilePlayer* player = nullptr;
+    std::atomic<float> parameters[PARAM_COUNT];
+    // Parameter and bend events only keep their latest value until the
+    // events are all in, then each is applied to the voices once. A stream
+    // of controller moves costs one update per block, not one per message.
+    float pendingParameters[PARAM_COUNT];
+    uint32_t pendingParameterMask = 0;
+    float pendingBend = 1.0f;
+    bool bendPending = false;
+    EngineStats stats;
+    LatencyStats latency;
+    FlightRecorder flightRecorder;
+    CycleStats cycleStats;
+    PolyphonyGovernor governor;
+    std::atomic<QualityTier> requestedTier{QUALITY_STANDARD};
+    QualityTier currentTier = QUALITY_STANDARD;     // what the voices are set to, audio thread only
+    uint64_t blockCount = 0;
+};
+
+#endif
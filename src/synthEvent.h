@@ -0,0 +1,38 @@
+#ifndef SYNTHEVENT_H
+#define SYNTHEVENT_H
+
+#include "sharedTables.h"
+#include <chrono>
+#include <cstdint>
+
+enum SynthEventType : uint8_t {
+    EVENT_NOTE_ON,
+    EVENT_NOTE_OFF,
+    EVENT_PARAMETER,
+    EVENT_PITCH_BEND,       // value is the frequency ratio, 1 = no bend
+    EVENT_ALL_NOTES_OFF,    // releases every held note
+    EVENT_ALL_SOUND_OFF,    // silences every voice at once
+    EVENT_QUALITY           // param is the QualityTier
+};
+
+// What the MIDI and GUI threads hand to the audio thread. Plain data, it is
+// memcpy'd through a RingBufferT.
+struct SynthEvent {
+    uint8_t type;
+    uint8_t note;
+    uint8_t velocity;
+    uint64_t receivedNs;   // steadyNowNs() when the event arrived, 0 if unknown
+    uint8_t param;         // SynthParam for EVENT_PARAMETER, QualityTier for EVENT_QUALITY
+    float value;
+};
+
+inline float midiNoteToHz(int midiNote) {
+    return sharedTables().noteHz[midiNote & (SharedTables::NOTE_COUNT - 1)];
+}
+
+inline uint64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
@@ -0,0 +1,23 @@
+#include "synthFarm.h"
+
+static const unsigned int MAX_CHANNELS = 2;
+
+SynthFarm::SynthFarm(const SynthConfig& config, int instances, int workers) : config(config), pool(workers) {
+    for (int i = 0; i < instances; ++i) {
+        synths.emplace_back(new Synth(config));
+        // offline, a block has no deadline to back off for
+        synths.back()->getEngine()->getGovernor().setEnabled(false);
+        outputs.emplace_back(config.maxFrames * MAX_CHANNELS, 0.0f);
+    }
+}
+
+void SynthFarm::render(unsigned int nFrames, unsigned int nChannels) {
+    if (nFrames > config.maxFrames) nFrames = config.maxFrames;
+    if (nChannels > MAX_CHANNELS) nChannels = MAX_CHANNELS;
+    for (size_t i = 0; i < synths.size(); ++i) {
+        SynthEngine* engine = synths[i]->getEngine();
+        float* out = outputs[i].data();
+        pool.submit([engine, out, nFrames, nChannels] { engine->render(out, nFrames, nChannels); });
+    }
+    pool.wait();
+}
@@ -0,0 +1,34 @@
+#ifndef SYNTHFARM_H
+#define SYNTHFARM_H
+
+#include "synth.h"
+#include "workerPool.h"
+#include <memory>
+#include <vector>
+
+// Many independent Synth instances in one process, for server side
+// rendering. Each has its own voices, parameters and output buffer; the
+// read-only tables are shared, and every block renders as one task per
+// instance on a shared WorkerPool. Nothing here is real-time.
+//
+// Every instance runs at config's rates (Stk keeps only one).
+class SynthFarm {
+public:
+    SynthFarm(const SynthConfig& config, int instances, int workers);
+
+    // Renders the next nFrames (up to config.maxFrames) of every instance
+    void render(unsigned int nFrames, unsigned int nChannels);
+
+    int getInstanceCount() const { return static_cast<int>(synths.size()); }
+    Synth& getInstance(int i) { return *synths[i]; }
+    const float* getOutput(int i) const { return outputs[i].data(); }
+    WorkerPool& getPool() { return pool; }
+
+private:
+    SynthConfig config;
+    std::vector<std::unique_ptr<Synth>> synths;
+    std::vector<std::vector<float>> outputs;
+    WorkerPool pool;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "synthParameters.h"
+#include <cstring>
+
+// Ranges are the GUI knobs'. The defaults are what a fresh Voice sounded like.
+static const SynthParamInfo params[PARAM_COUNT] = {
+    {"osc1_tune",      1.0f / 1.05946f, 1.05946f, 1.0f},
+    {"osc2_tune",      1.0f / 1.05946f, 1.05946f, 1.0f},
+    {"osc1_waveform",  0.0f,    1.0f,     0.0f},
+    {"osc2_waveform",  0.0f,    1.0f,     0.0f},
+    {"osc1_volume",    0.0f,    1.0f,     1.0f},
+    {"osc2_volume",    0.0f,    1.0f,     1.0f},
+    {"xmod",           0.0f,    1.0f,     0.0f},
+    {"cutoff",         0.1f,    1000.0f,  1000.0f},
+    {"resonance",      0.1f,    10.0f,    1.0f},
+    {"feg_amount",     0.0f,    1000.0f,  0.0f},
+    {"aeg_attack",     0.001f,  5.0f,     0.01f},
+    {"aeg_decay",      0.03f,   2.0f,     1.5f},
+    {"aeg_sustain",    0.0f,    1.0f,     0.0f},
+    {"aeg_release",    0.001f,  3.0f,     0.1f},
+    {"feg_attack",     0.001f,  5.0f,     0.01f},
+    {"feg_decay",      0.03f,   2.0f,     1.5f},
+    {"feg_sustain",    0.0f,    1.0f,     0.0f},
+    {"feg_release",    0.001f,  3.0f,     0.1f},
+};
+
+const SynthParamInfo& synthParamInfo(SynthParam param) {
+    return params[param];
+}
+
+SynthParam findSynthParam(const char* name) {
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (std::strcmp(params[p].name, name) == 0) return static_cast<SynthParam>(p);
+    }
+    return PARAM_COUNT;
+}
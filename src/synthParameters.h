@@ -1,6 +1,8 @@
 #ifndef SYNTHPARAMETERS_H
 #define SYNTHPARAMETERS_H
 
+#include <cstdint>
+
 typedef struct {
     float attackTime;
     float decayTime;
@@ -8,4 +10,39 @@ typedef struct {
     float releaseTime;
 } adsrParameters;
 
-#endif
\ No newline at end of file
+// Everything a host (or the GUI) can set, applied to every voice
+enum SynthParam : uint8_t {
+    PARAM_OSC1_TUNE,
+    PARAM_OSC2_TUNE,
+    PARAM_OSC1_WAVEFORM,    // 0 saw, 1 square
+    PARAM_OSC2_WAVEFORM,
+    PARAM_OSC1_VOLUME,
+    PARAM_OSC2_VOLUME,
+    PARAM_XMOD,
+    PARAM_CUTOFF,
+    PARAM_RESONANCE,
+    PARAM_FEG_AMOUNT,
+    PARAM_AEG_ATTACK,
+    PARAM_AEG_DECAY,
+    PARAM_AEG_SUSTAIN,
+    PARAM_AEG_RELEASE,
+    PARAM_FEG_ATTACK,
+    PARAM_FEG_DECAY,
+    PARAM_FEG_SUSTAIN,
+    PARAM_FEG_RELEASE,
+    PARAM_COUNT
+};
+
+struct SynthParamInfo {
+    const char* name;
+    float min;
+    float max;
+    float defaultValue;
+};
+
+// param must be < PARAM_COUNT
+const SynthParamInfo& synthParamInfo(SynthParam param);
+// PARAM_COUNT if there is no parameter with that name
+SynthParam findSynthParam(const char* name);
+
+#endif
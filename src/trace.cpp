@@ -0,0 +1,132 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const size_t TRACE_EVENTS_PER_THREAD = 1 << 16;
+
+struct TraceEvent {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+    int arg;
+};
+
+// One ring entry, a seqlock: the writer makes sequence odd, stores the fields
+// and sets it to 2 * (event number + 1). The dumper keeps a copy only if it
+// saw that same even value before and after reading the fields. Everything is
+// atomic so the dumper's reads never race with the writer's stores.
+struct TraceSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> startNs{0};
+    std::atomic<uint64_t> endNs{0};
+    std::atomic<int> arg{0};
+};
+
+struct TraceBuffer {
+    std::string threadName;
+    int threadId;
+    std::unique_ptr<TraceSlot[]> slots;
+    std::atomic<uint64_t> written{0};   // total events ever written, the ring index is written % size
+};
+
+static std::atomic<bool> tracing(false);
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> registry;
+static thread_local TraceBuffer* threadBuffer = nullptr;
+static const auto traceEpoch = std::chrono::steady_clock::now();
+
+void traceSetEnabled(bool enabled) {
+    tracing.store(enabled, std::memory_order_relaxed);
+}
+
+bool traceEnabled() {
+    return tracing.load(std::memory_order_relaxed);
+}
+
+void traceRegisterThread(const char* threadName) {
+    if (threadBuffer) return;
+    std::unique_ptr<TraceBuffer> buffer(new TraceBuffer);
+    buffer->threadName = threadName;
+    buffer->slots.reset(new TraceSlot[TRACE_EVENTS_PER_THREAD]);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->threadId = static_cast<int>(registry.size()) + 1;
+    threadBuffer = buffer.get();
+    registry.push_back(std::move(buffer));
+}
+
+uint64_t traceNow() {
+    auto elapsed = std::chrono::steady_clock::now() - traceEpoch;
+    // +1 so that a valid timestamp is never 0, TraceSpan uses 0 for "not recording"
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() + 1;
+}
+
+void traceRecord(const char* name, uint64_t startNs, uint64_t endNs, int arg) {
+    TraceBuffer* buffer = threadBuffer;
+    if (!buffer || !traceEnabled()) return;
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer->slots[index % TRACE_EVENTS_PER_THREAD];
+    // release stores keep the odd sequence ahead of the fields without a
+    // fence (ThreadSanitizer doesn't model those); plain moves on x86
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_release);
+    slot.startNs.store(startNs, std::memory_order_release);
+    slot.endNs.store(endNs, std::memory_order_release);
+    slot.arg.store(arg, std::memory_order_release);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+static void writeEvent(std::ofstream& out, const TraceEvent& event, int threadId, bool& first) {
+    out << (first ? "\n" : ",\n");
+    first = false;
+    out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId
+        << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0;
+    if (event.arg >= 0) out << ",\"args\":{\"arg\":" << event.arg << "}";
+    out << "}";
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out.precision(3);
+    out << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    std::vector<TraceEvent> copy;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& buffer : registry) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+
+        const uint64_t size = TRACE_EVENTS_PER_THREAD;
+        uint64_t end = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = end > size ? end - size : 0;
+        copy.clear();
+        for (uint64_t i = begin; i < end; ++i) {
+            // the writer kept going while we copied: a slot it has started
+            // on again since holds another event, or half of one, and is left out
+            const TraceSlot& slot = buffer->slots[i % size];
+            uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * i + 2) continue;
+            TraceEvent event;
+            // acquire: seeing any of a newer write's fields means seeing its odd sequence below
+            event.name = slot.name.load(std::memory_order_acquire);
+            event.startNs = slot.startNs.load(std::memory_order_acquire);
+            event.endNs = slot.endNs.load(std::memory_order_acquire);
+            event.arg = slot.arg.load(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+            copy.push_back(event);
+        }
+        for (const TraceEvent& event : copy) writeEvent(out, event, buffer->threadId, first);
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,43 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// Opt-in span tracing for the audio, MIDI and GUI threads, written out as
+// Chrome / Perfetto trace-event JSON (load it in ui.perfetto.dev or chrome://tracing).
+//
+// Every thread records into its own fixed-size ring, so recording a span is a
+// couple of stores with no locks or allocation. A thread has to call
+// traceRegisterThread() once (that part allocates) before its spans are kept;
+// spans from unregistered threads are dropped. Span names must be string literals.
+
+void traceSetEnabled(bool enabled);
+bool traceEnabled();
+
+void traceRegisterThread(const char* threadName);
+
+uint64_t traceNow();
+void traceRecord(const char* name, uint64_t startNs, uint64_t endNs, int arg = -1);
+
+// Writes everything the rings currently hold. Safe to call while the other
+// threads keep recording; spans overwritten during the copy are left out.
+bool writeChromeTrace(const std::string& path);
+
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, int arg = -1)
+        : name(name), arg(arg), start(traceEnabled() ? traceNow() : 0) {}
+    ~TraceSpan() {
+        if (start != 0) traceRecord(name, start, traceNow(), arg);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    int arg;
+    uint64_t start;
+};
+
+#endif
@@ -1,17 +1,44 @@
 #include "voice.h"
+#include "OberheimVariationModel.h"
+#include "HuovilainenModel.h"
 #include <stdio.h>
 
+const char* oscillatorTypeName(int type) {
+    static const char* names[OSCILLATOR_TYPE_COUNT] = {"saw/saw", "saw/square", "square/saw", "square/square"};
+    return (type >= 0 && type < OSCILLATOR_TYPE_COUNT) ? names[type] : "unknown";
+}
+
+int Voice::getOscillatorType() const {
+    return osc1->getWaveform() * 2 + osc2->getWaveform();
+}
+
 void Voice::setFrequency(double frequency) {
     osc1->setBaseFrequency(frequency);
     osc2->setBaseFrequency(frequency);
 }
 
+static_assert(MAX_OVERSAMPLING == 2, "the voice only has a 2x oversampler");
+
+// The part of the tier's oversampling the model doesn't do by itself
+static int voiceOversampling(const QualitySettings& settings) {
+    int factor = settings.oversampling / filterModelOversampling(settings.filter);
+    return factor > 1 ? factor : 1;
+}
+
 Voice::Voice(float samplerate)
 {
     std::cout << "creating voice\n";
     osc1   = std::make_unique<Oscillator>();
     osc2   = std::make_unique<Oscillator>();
-    filter = std::make_unique<OberheimVariationMoog>(samplerate);
+    for (int factor = 1; factor <= MAX_OVERSAMPLING; ++factor) {
+        filters[FILTER_OBERHEIM][factor - 1] = std::make_unique<OberheimVariationMoog>(samplerate * factor);
+        if (factor * filterModelOversampling(FILTER_HUOVILAINEN) <= MAX_OVERSAMPLING || factor == 1) {
+            filters[FILTER_HUOVILAINEN][factor - 1] = std::make_unique<HuovilainenMoog>(samplerate * factor);
+        }
+    }
+    quality = qualitySettings(QUALITY_STANDARD);
+    filterOversampling = voiceOversampling(quality);
+    filter = filters[quality.filter][filterOversampling - 1].get();
     aeg    = std::make_unique<stk::ADSR>();
     feg    = std::make_unique<stk::ADSR>();
     this->setFrequency(220.0);
@@ -20,13 +47,122 @@ Voice::Voice(float samplerate)
 }
 
 double Voice::tick() {
-    float osc1sample = osc1->tick();
-    float osc2sample = osc2->tick();
-    float sample = (osc1sample * osc1volume + osc2sample * osc2volume) / 2;
-    sample += (osc1sample * osc2sample) * xModVolume;
-    filter->SetCutoff(baseCutoff + (feg->tick() * fegAmount));
-    filter->Process(&sample, 1);
-    return (double) sample * aeg->tick();
+    float sample;
+    renderChunk<false>(&sample, 1, nullptr);
+    return sample;
+}
+
+void Voice::render(float* out, unsigned int nFrames, VoiceProfile* profile) {
+    while (nFrames > 0) {
+        unsigned int chunk = nFrames < RENDER_CHUNK ? nFrames : RENDER_CHUNK;
+        if (profile) renderChunk<true>(out, chunk, profile);
+        else renderChunk<false>(out, chunk, nullptr);
+        out += chunk;
+        nFrames -= chunk;
+    }
+}
+
+// Same maths as the old per-sample tick(), split into stages so each stage
+// runs over the whole chunk and can be timed on its own.
+template <bool PROFILE>
+void Voice::renderChunk(float* out, unsigned int nFrames, VoiceProfile* profile) {
+    uint64_t t0 = PROFILE ? readCycleCounter() : 0;
+
+    for (unsigned int n = 0; n < nFrames; ++n) {
+        float osc1sample = osc1->tick();
+        float osc2sample = osc2->tick();
+        float sample = (osc1sample * osc1volume + osc2sample * osc2volume) / 2;
+        sample += (osc1sample * osc2sample) * xModVolume;
+        oscBuffer[n] = sample;
+    }
+
+    uint64_t t1 = PROFILE ? readCycleCounter() : 0;
+
+    for (unsigned int n = 0; n < nFrames; ++n) {
+        fegBuffer[n] = feg->tick();
+        aegBuffer[n] = aeg->tick();
+    }
+
+    if (PROFILE) {
+        uint64_t t2 = readCycleCounter();
+        profile->ticks[STAGE_OSCILLATOR] += t1 - t0;
+        profile->ticks[STAGE_ENVELOPE] += t2 - t1;
+    }
+
+    // the cutoff follows the filter envelope once every controlRate samples
+    uint64_t coefficients = 0;
+    uint64_t processing = 0;
+    for (unsigned int n = 0; n < nFrames; ++n) {
+        uint64_t a = PROFILE ? readCycleCounter() : 0;
+        if (controlCounter == 0) {
+            updateCutoff(baseCutoff + (fegBuffer[n] * fegAmount));
+            controlCounter = quality.controlRate;
+        }
+        --controlCounter;
+        uint64_t b = PROFILE ? readCycleCounter() : 0;
+        float input = oscBuffer[n];
+        float sample = runFilter(filter, filterOversampling, oversamplers[quality.filter], input);
+        if (fadingFilter) {
+            float amount = static_cast<float>(fadeRemaining) / FILTER_FADE_SAMPLES;
+            float fading = runFilter(fadingFilter, fadingOversampling, oversamplers[fadingModel], input);
+            sample = sample * (1.0f - amount) + fading * amount;
+            if (--fadeRemaining == 0) fadingFilter = nullptr;
+        }
+        oscBuffer[n] = sample;
+        if (PROFILE) {
+            uint64_t c = readCycleCounter();
+            coefficients += b - a;
+            processing += c - b;
+        }
+    }
+
+    if (PROFILE) {
+        profile->ticks[STAGE_FILTER_COEFFICIENTS] += coefficients;
+        profile->ticks[STAGE_FILTER_PROCESS] += processing;
+        profile->samples += nFrames;
+    }
+
+    for (unsigned int n = 0; n < nFrames; ++n) out[n] = oscBuffer[n] * aegBuffer[n];
+}
+
+// Oversampled filters get their input through the oversampler's
+// interpolation kernel and their output back through its decimation one
+float Voice::runFilter(LadderFilterBase* f, int oversampling, Oversampler2x& oversampler, float input) {
+    if (oversampling == 1) {
+        f->Process(&input, 1);
+        return input;
+    }
+    float samples[MAX_OVERSAMPLING];
+    oversampler.up(input, samples);
+    f->Process(samples, MAX_OVERSAMPLING);
+    return oversampler.down(samples);
+}
+
+void Voice::updateCutoff(float cutoff) {
+    filter->SetCutoff(cutoff);
+    if (fadingFilter) fadingFilter->SetCutoff(cutoff);
+}
+
+void Voice::setQuality(const QualitySettings& settings) {
+    int nextOversampling = voiceOversampling(settings);
+    LadderFilterBase* next = filters[settings.filter][nextOversampling - 1].get();
+    if (next != filter) {
+        if (isActive()) {
+            fadingFilter = filter;
+            fadingOversampling = filterOversampling;
+            fadingModel = quality.filter;
+            fadeRemaining = FILTER_FADE_SAMPLES;
+        }
+        // the history left over from whenever it last ran is stale
+        if (nextOversampling > 1) oversamplers[settings.filter].reset();
+        filter = next;
+        filterOversampling = nextOversampling;
+    }
+    osc1->setBackend(settings.oscillator, isActive());
+    osc2->setBackend(settings.oscillator, isActive());
+    quality = settings;
+    controlCounter = 0;
+    updateSaturation();
 }
 
 void Voice::noteOn() {
@@ -39,9 +175,44 @@ void Voice::noteOff() {
     feg->keyOff();
 }
 
+// A voice is busy until its amplitude envelope has finished the release
+bool Voice::isActive() const {
+    return aeg->getState() != stk::ADSR::IDLE;
+}
+
+bool Voice::isReleasing() const {
+    return aeg->getState() == stk::ADSR::RELEASE;
+}
+
+float Voice::envelopeLevel() const {
+    return aeg->lastOut();
+}
+
+// Dropping the envelope to zero and releasing makes the ADSR go idle on its next tick.
+// setValue() also makes the value the sustain level, so the patch's goes back.
+void Voice::kill() {
+    aeg->setValue(0.0);
+    aeg->setSustainLevel(aegSustain);
+    aeg->keyOff();
+    feg->keyOff();
+}
+
+void Voice::setFastSaturation(bool fast) {
+    governorFastSaturation = fast;
+    updateSaturation();
+}
+
+void Voice::updateSaturation() {
+    bool fast = quality.fastSaturation || governorFastSaturation;
+    for (int m = 0; m < FILTER_MODEL_COUNT; ++m) {
+        for (int f = 0; f < MAX_OVERSAMPLING; ++f) {
+            if (filters[m][f]) filters[m][f]->SetFastSaturation(fast);
+        }
+    }
+}
+
 void Voice::setXModVolume(float value) {
     xModVolume = value;
-    std::cout << xModVolume << "\n";
 }
 
 // AEG
@@ -52,6 +223,7 @@ void Voice::setAegDecay(float value) {
     aeg->setDecayTime(value);
 }
 void Voice::setAegSustain(float value) {
+    aegSustain = value;
     aeg->setSustainLevel(value);
 }
 void Voice::setAegRelease(float value) {
@@ -80,6 +252,10 @@ void Voice::setOscDetune(int osc, float value) {
         osc2->setDetune(value);
     }
 }
+void Voice::setPitchBend(float ratio) {
+    osc1->setBend(ratio);
+    osc2->setBend(ratio);
+}
 void Voice::setOscVolume(int osc, float value) {
     (osc == 1) ? osc1volume = value : osc2volume = value;
 }
@@ -92,13 +268,23 @@ void Voice::toggleOscWaveform(int osc, bool value) {
     }
 }
 
+void Voice::setOscWaveform(int osc, Waveform waveform) {
+    if (osc == 1) osc1->setWaveform(waveform);
+    if (osc == 2) osc2->setWaveform(waveform);
+}
+
 
 // FILTER
 void Voice::setCutoff(float value) {
     baseCutoff = value*2;
 }
+// The knob goes 0.1 to 10 the way the Oberheim model wants it, the
+// Huovilainen model self-oscillates at 1
 void Voice::setResonance(float value) {
-    filter->SetResonance(value);
+    for (int f = 0; f < MAX_OVERSAMPLING; ++f) {
+        filters[FILTER_OBERHEIM][f]->SetResonance(value);
+        if (filters[FILTER_HUOVILAINEN][f]) filters[FILTER_HUOVILAINEN][f]->SetResonance(value / 10.0f);
+    }
 }
 void Voice::setFegAmount(float value) {
     fegAmount = value*2;
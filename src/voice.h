@@ -5,10 +5,18 @@
 #include "stk/BlitSquare.h"
 #include "stk/ADSR.h"
 #include <stdio.h>
-#include "OberheimVariationModel.h"
+#include "LadderFilterBase.h"
 #include "oscillator.h"
+#include "quality.h"
+#include "resampler.h"
 #include "memory"
 
+#include "cycleCounter.h"
+
+// Waveforms of both oscillators, osc1 * 2 + osc2
+const int OSCILLATOR_TYPE_COUNT = 4;
+const char* oscillatorTypeName(int type);
+
 class Voice
 {
 private:
@@ -18,19 +26,63 @@ private:
     float osc2volume = 1.0f;
     float xModVolume = 0.0f;
 
-    std::unique_ptr<OberheimVariationMoog> filter;
+    // Every model at every factor the voice can oversample it by is built up
+    // front so a quality change never allocates; filters[model][factor - 1],
+    // null where the model's own oversampling already takes up the rest.
+    // filter is the one in use; after a change the previous one is
+    // crossfaded out over FILTER_FADE_SAMPLES.
+    std::unique_ptr<LadderFilterBase> filters[FILTER_MODEL_COUNT][MAX_OVERSAMPLING];
+    LadderFilterBase* filter;
+    LadderFilterBase* fadingFilter = nullptr;
+    static const int FILTER_FADE_SAMPLES = 64;
+    int fadeRemaining = 0;
+    int filterOversampling = 1;     // what the voice adds on top of the model
+    int fadingOversampling = 1;
+    FilterModel fadingModel = FILTER_OBERHEIM;
+    Oversampler2x oversamplers[FILTER_MODEL_COUNT];
+
+    QualitySettings quality;
+    bool governorFastSaturation = false;
+    int controlCounter = 0;         // samples until the next cutoff update
     std::unique_ptr<stk::ADSR> aeg;
     std::unique_ptr<stk::ADSR> feg;
+    float aegSustain = 0.0f;        // the patch's, kill() has to put it back
     float fegAmount;
     float baseCutoff;
 
+    // scratch space for render(), which works through the block in pieces of this size
+    static const unsigned int RENDER_CHUNK = 64;
+    float oscBuffer[RENDER_CHUNK];
+    float aegBuffer[RENDER_CHUNK];
+    float fegBuffer[RENDER_CHUNK];
+
+    template <bool PROFILE>
+    void renderChunk(float* out, unsigned int nFrames, VoiceProfile* profile);
+    float runFilter(LadderFilterBase* f, int oversampling, Oversampler2x& oversampler, float input);
+    void updateCutoff(float cutoff);
+    void updateSaturation();
+
 public:
     Voice(float samplerate);
     ~Voice() = default;
     double tick();
+    // Renders nFrames samples, identical to calling tick() nFrames times.
+    // With a profile the time spent in each stage is added to it.
+    void render(float* out, unsigned int nFrames, VoiceProfile* profile = nullptr);
     void setFrequency(double frequency);
     void noteOn();
     void noteOff();
+    bool isActive() const;
+    bool isReleasing() const;
+    float envelopeLevel() const;
+    void kill();        // silent from the next sample, no release
+    void setFastSaturation(bool fast);       // the governor's override, on top of the quality setting
+    // Applies from the next sample; an active voice crossfades into the new
+    // filter and oscillators instead of jumping
+    void setQuality(const QualitySettings& settings);
+    FilterModel getFilterModel() const { return quality.filter; }
+    int getOversampling() const { return quality.oversampling; }
+    int getOscillatorType() const;
 
     void setAegAttack(float value);
     void setAegDecay(float value);
@@ -43,9 +95,11 @@ public:
     void setFegRelease(float value);
 
     void setOscDetune(int osc, float value);
+    void setPitchBend(float ratio);
     void setOscVolume(int osc, float value);
     void setXModAmount(float value);
     void toggleOscWaveform(int osc, bool value);
+    void setOscWaveform(int osc, Waveform waveform);
 
     void setCutoff(float value);
     void setResonance(float value);
@@ -1,39 +1,72 @@
 #include "voiceAllocator.h"
+#include "probes.h"
 #include <stdio.h>
 
 voiceAllocator::voiceAllocator(Voice* inputVoices[], int inputNVoices)
-    : nVoices(inputNVoices) {
-    for (int i = 0; i < nVoices && i < 8; ++i) {
-        voices[i] = inputVoices[i];
+    : voices(inputVoices, inputVoices + inputNVoices), nVoices(inputNVoices),
+      voiceInUse(inputNVoices, false), notes(inputNVoices, 0.0f), voiceLimit(inputNVoices) {}
+
+void voiceAllocator::setVoiceLimit(int limit) {
+    if (limit < 1) limit = 1;
+    if (limit > nVoices) limit = nVoices;
+    voiceLimit = limit;
+}
+
+int voiceAllocator::activeVoices() const {
+    int count = 0;
+    for (int i = 0; i < nVoices; ++i) {
+        if (voices[i]->isActive()) ++count;
     }
-    for (int i = 0; i < 8; i++) {
-        voiceInUse[i] = false;
+    return count;
+}
+
+// The quietest voice that has been released, -1 if every sounding voice is held
+int voiceAllocator::takeReleasingVoice() const {
+    int quietest = -1;
+    for (int i = 0; i < nVoices; ++i) {
+        if (voiceInUse[i] || !voices[i]->isActive()) continue;
+        if (quietest < 0 || voices[i]->envelopeLevel() < voices[quietest]->envelopeLevel()) quietest = i;
     }
+    return quietest;
 }
 
-void voiceAllocator::noteOn(float frequency) {
-    for (int i = nextVoice; i < nVoices + nextVoice && i < 8 + nextVoice; ++i) {
-        std::cout << "i: " << i << std::endl;
+// Runs on the audio thread, so no printing in here
+int voiceAllocator::noteOn(float frequency) {
+    if (voiceLimit < nVoices && activeVoices() >= voiceLimit) {
+        int j = takeReleasingVoice();
+        if (j < 0) {
+            ++notesDropped;
+            return -1;
+        }
+        SYNTH_PROBE2(voice_steal, j, static_cast<int>(notes[j]));
+        voices[j]->setFrequency(frequency);
+        voices[j]->noteOn();
+        voiceInUse[j] = true;
+        notes[j] = frequency;
+        return j;
+    }
+
+    for (int i = nextVoice; i < nVoices + nextVoice; ++i) {
         int j = i % nVoices;
-        std::cout << "j: " << j << std::endl;
 
         if (!voiceInUse[j]) {
-            // use this voice
-            std::cout << "voice: " << j << std::endl;
-
+            // use this voice, cutting off its release tail if it still has one
+            if (voices[j]->isActive()) SYNTH_PROBE2(voice_steal, j, static_cast<int>(notes[j]));
             voices[j]->setFrequency(frequency);
             voices[j]->noteOn();
             voiceInUse[j] = true;
             notes[j] = frequency;
             nextVoice++;
             nextVoice %= nVoices;
-            return;
+            return j;
         }
     }
+    ++notesDropped;
+    return -1;
 }
 
 void voiceAllocator::noteOff(float frequency) {
-    for (int i = 0; i < nVoices && i < 8; ++i) {
+    for (int i = 0; i < nVoices; ++i) {
         if (notes[i] == frequency) {
             voices[i]->noteOff();
             voiceInUse[i] = false;
@@ -41,6 +74,13 @@ void voiceAllocator::noteOff(float frequency) {
     }
 }
 
+void voiceAllocator::allNotesOff() {
+    for (int i = 0; i < nVoices; ++i) {
+        if (voiceInUse[i]) voices[i]->noteOff();
+        voiceInUse[i] = false;
+    }
+}
+
 /*
 Allocator should never play a note on a voice that is already in use,
 except if all voices are in use. In that case it should replace the voice
@@ -2,18 +2,31 @@
 #define VOICEALLOCATOR_H
 
 #include "voice.h"
+#include <vector>
 
 class voiceAllocator {
 public:
     voiceAllocator(Voice* inputVoices[], int inputNVoices);
-    void noteOn(float frequency);
+    int noteOn(float frequency);    // returns the voice that got the note, -1 if none was free
     void noteOff(float frequency);
+    void allNotesOff();
+
+    // At most `limit` voices sounding at once. At the limit a new note takes
+    // over a voice that is already releasing, or is dropped if there is none.
+    void setVoiceLimit(int limit);
+    int getVoiceLimit() const { return voiceLimit; }
+    int getNotesDropped() const { return notesDropped; }
 private:
-    Voice* voices[8];
+    int activeVoices() const;
+    int takeReleasingVoice() const;
+
+    std::vector<Voice*> voices;
     int nVoices;
-    bool voiceInUse[8];
-    float notes[8] = {0};
+    std::vector<bool> voiceInUse;
+    std::vector<float> notes;
     int nextVoice = 0;
+    int voiceLimit;
+    int notesDropped = 0;
 };
 
 #endif
\ No newline at end of file
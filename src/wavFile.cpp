@@ -0,0 +1,97 @@
+#include "wavFile.h"
+#include <cstring>
+
+static void put16(unsigned char* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static uint16_t get16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void put32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (v >> (8 * i)) & 0xff;
+}
+
+bool writeWavHeader(FILE* file, unsigned int sampleRate, unsigned int channels, unsigned int bitsPerSample,
+                    bool isFloat, uint64_t dataBytes) {
+    const uint32_t bytesPerFrame = channels * bitsPerSample / 8;
+    if (dataBytes > 0xffffffffull - 36) dataBytes = 0xffffffffull - 36;
+
+    unsigned char header[44];
+    std::memcpy(header, "RIFF", 4);
+    put32(header + 4, static_cast<uint32_t>(36 + dataBytes));
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);
+    put16(header + 20, isFloat ? 3 : 1);
+    put16(header + 22, static_cast<uint16_t>(channels));
+    put32(header + 24, sampleRate);
+    put32(header + 28, sampleRate * bytesPerFrame);
+    put16(header + 32, static_cast<uint16_t>(bytesPerFrame));
+    put16(header + 34, static_cast<uint16_t>(bitsPerSample));
+    std::memcpy(header + 36, "data", 4);
+    put32(header + 40, static_cast<uint32_t>(dataBytes));
+
+    long end = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    bool ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    if (end > 0) std::fseek(file, end, SEEK_SET);
+    std::fflush(file);
+    return ok;
+}
+
+bool readFloatWav(const std::string& path, unsigned int& sampleRate, unsigned int& channels,
+                  std::vector<float>& samples, std::string& error) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "could not open " + path;
+        return false;
+    }
+    unsigned char riff[12];
+    bool ok = std::fread(riff, 1, sizeof(riff), file) == sizeof(riff) && std::memcmp(riff, "RIFF", 4) == 0 &&
+              std::memcmp(riff + 8, "WAVE", 4) == 0;
+    bool haveFormat = false;
+    // walk the chunks, skipping whatever isn't fmt or data
+    while (ok) {
+        unsigned char chunk[8];
+        if (std::fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) {
+            ok = false;
+            break;
+        }
+        uint32_t size = get32(chunk + 4);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            unsigned char format[16];
+            ok = std::fread(format, 1, sizeof(format), file) == sizeof(format);
+            if (!ok) break;
+            if (get16(format) != 3 || get16(format + 14) != 32) {
+                error = path + " is not a 32 bit float WAV file";
+                std::fclose(file);
+                return false;
+            }
+            channels = get16(format + 2);
+            sampleRate = get32(format + 4);
+            haveFormat = channels > 0;
+            std::fseek(file, size - 16 + (size & 1), SEEK_CUR);
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                ok = false;
+                break;
+            }
+            samples.resize(size / sizeof(float));
+            ok = std::fread(samples.data(), sizeof(float), samples.size(), file) == samples.size();
+            break;
+        }
+        else {
+            std::fseek(file, size + (size & 1), SEEK_CUR);
+        }
+    }
+    std::fclose(file);
+    if (!ok) error = path + " is not a readable WAV file";
+    return ok;
+}
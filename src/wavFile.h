@@ -0,0 +1,20 @@
+#ifndef WAVFILE_H
+#define WAVFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Writes (or rewrites) the 44 byte RIFF header at the start of file and puts
+// the file position back where it was. Float data is WAVE_FORMAT_IEEE_FLOAT,
+// otherwise integer PCM. Sizes clamp at 4 GB.
+bool writeWavHeader(FILE* file, unsigned int sampleRate, unsigned int channels, unsigned int bitsPerSample,
+                    bool isFloat, uint64_t dataBytes);
+
+// Reads a 32 bit float WAV file, what the batch renderer and the golden
+// references write. samples are interleaved.
+bool readFloatWav(const std::string& path, unsigned int& sampleRate, unsigned int& channels,
+                  std::vector<float>& samples, std::string& error);
+
+#endif
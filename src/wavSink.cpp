@@ -0,0 +1,43 @@
+#include "wavSink.h"
+#include "wavFile.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+WavSink::WavSink(const std::string& path) : ThreadedSink(false), path(path) {}
+
+WavSink::~WavSink() {
+    stop();
+}
+
+bool WavSink::open(unsigned int& rate, unsigned int& frames, RenderCallback callback, void* userData) {
+    if (!ThreadedSink::open(rate, frames, callback, userData)) return false;
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Could not open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    writeHeader();
+    return true;
+}
+
+void WavSink::stop() {
+    ThreadedSink::stop();
+    if (!file) return;
+    writeHeader();
+    std::fclose(file);
+    file = nullptr;
+}
+
+bool WavSink::consume(const float* samples, unsigned int nFrames) {
+    if (std::fwrite(samples, sizeof(float) * CHANNELS, nFrames, file) != nFrames) {
+        std::cerr << "Writing " << path << " failed" << std::endl;
+        return false;
+    }
+    framesWritten += nFrames;
+    return true;
+}
+
+void WavSink::writeHeader() {
+    writeWavHeader(file, sampleRate, CHANNELS, 32, true, framesWritten * sizeof(float) * CHANNELS);
+}
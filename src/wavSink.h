@@ -0,0 +1,30 @@
+#ifndef WAVSINK_H
+#define WAVSINK_H
+
+#include "audioSink.h"
+#include <cstdint>
+#include <cstdio>
+
+// Streams 32-bit float stereo WAV to disk block by block. The header goes
+// out with zero sizes first and gets its sizes filled in when the sink stops.
+class WavSink : public ThreadedSink {
+public:
+    explicit WavSink(const std::string& path);
+    ~WavSink() override;
+    const char* name() const override { return "wav"; }
+
+    bool open(unsigned int& sampleRate, unsigned int& bufferFrames, RenderCallback callback, void* userData) override;
+    void stop() override;
+
+protected:
+    bool consume(const float* samples, unsigned int nFrames) override;
+
+private:
+    void writeHeader();
+
+    std::string path;
+    FILE* file = nullptr;
+    uint64_t framesWritten = 0;
+};
+
+#endif
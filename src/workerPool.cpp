@@ -0,0 +1,97 @@
+#include "workerPool.h"
+
+WorkerPool::WorkerPool(int nThreads) {
+    if (nThreads <= 0) nThreads = static_cast<int>(std::thread::hardware_concurrency());
+    if (nThreads <= 0) nThreads = 1;
+    for (int i = 0; i < nThreads; ++i) queues.emplace_back(new Queue());
+    for (int i = 0; i < nThreads; ++i) threads.emplace_back(&WorkerPool::workerLoop, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+void WorkerPool::submit(Task task) {
+    unfinished.fetch_add(1);
+    Queue& queue = *queues[nextQueue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // under the lock, so a worker can't check for work and go to sleep in between
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued.fetch_add(1);
+    }
+    workAvailable.notify_one();
+}
+
+bool WorkerPool::take(int index, Task& task) {
+    int n = static_cast<int>(queues.size());
+    if (index >= 0) {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (int i = 1; i <= n; ++i) {
+        int victim = ((index < 0 ? 0 : index) + i) % n;
+        if (victim == index) continue;
+        Queue& other = *queues[victim];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            queued.fetch_sub(1);
+            if (index >= 0) steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::finish() {
+    if (unfinished.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        allDone.notify_all();
+    }
+}
+
+void WorkerPool::workerLoop(int index) {
+    Task task;
+    while (true) {
+        if (take(index, task)) {
+            task();
+            task = nullptr;
+            finish();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        workAvailable.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping) return;
+    }
+}
+
+void WorkerPool::wait() {
+    Task task;
+    while (unfinished.load() > 0) {
+        if (take(-1, task)) {
+            task();
+            task = nullptr;
+            finish();
+            continue;
+        }
+        // everything left is already running somewhere
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        allDone.wait(lock, [this] { return unfinished.load() == 0 || queued.load() > 0; });
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads with a task deque each. submit() deals tasks out
+// round robin; a worker takes from the back of its own deque and, once that
+// is empty, steals from the front of the others'. wait() blocks until every
+// task submitted so far has run, the calling thread pitches in meanwhile.
+//
+// Meant for offline / server rendering, submitting allocates.
+class WorkerPool {
+public:
+    typedef std::function<void()> Task;
+
+    // 0 threads = one per core
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    void submit(Task task);
+    void wait();
+
+    int getThreadCount() const { return static_cast<int>(threads.size()); }
+    uint64_t getSteals() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(int index);
+    // own deque first (back), then everyone else's (front); index -1 is the waiting caller
+    bool take(int index, Task& task);
+    void finish();
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    std::atomic<int> queued{0};       // sitting in a deque
+    std::atomic<int> unfinished{0};   // submitted and not done yet
+    std::atomic<uint64_t> steals{0};
+    unsigned int nextQueue = 0;
+    bool stopping = false;
+};
+
+#endif